@@ -25,6 +25,9 @@ public class AUv3IntensifierViewController: AUViewController, WKUIDelegate, WKNa
     var standaloneApp = false
 
     var needsConnection = true
+
+    // Polls the audio unit's meters while the view is on screen.
+    private var meterTimer: Timer?
     public var audioUnitCreated: AUv3Intensifier? {
         didSet {
             audioUnitCreated?.viewController = self
@@ -51,6 +54,48 @@ public class AUv3IntensifierViewController: AUViewController, WKUIDelegate, WKNa
         guard audioUnitCreated != nil else { return }
         connectViewToAU()
     }
+    #if os(macOS)
+    public override func viewDidAppear() {
+        super.viewDidAppear()
+        startMetering()
+    }
+    public override func viewWillDisappear() {
+        super.viewWillDisappear()
+        stopMetering()
+    }
+    #else
+    public override func viewDidAppear(_ animated: Bool) {
+        super.viewDidAppear(animated)
+        startMetering()
+    }
+    public override func viewWillDisappear(_ animated: Bool) {
+        super.viewWillDisappear(animated)
+        stopMetering()
+    }
+    #endif
+    private func startMetering() {
+        audioUnitCreated?.meteringEnabled = true
+        meterTimer?.invalidate()
+        meterTimer = Timer.scheduledTimer(withTimeInterval: 1.0 / 30.0, repeats: true) { [weak self] _ in
+            self?.updateMeter()
+        }
+    }
+    private func stopMetering() {
+        meterTimer?.invalidate()
+        meterTimer = nil
+        audioUnitCreated?.meteringEnabled = false
+    }
+    private func updateMeter() {
+        guard webPageLoaded, let reading = audioUnitCreated?.readMeter() else { return }
+        let script = """
+        if (window.updateMeter) {
+            window.updateMeter({inputPeak: \(reading.inputPeak), inputRMS: \(reading.inputRMS), outputPeak: \(reading.outputPeak), outputRMS: \(reading.outputRMS), attackEnvelope: \(reading.attackEnvelope), releaseEnvelope: \(reading.releaseEnvelope), gainDecibels: \(reading.gainDecibels)});
+        }
+        "ok";
+        """
+        webView.evaluateJavaScript(script) { (result, error) in
+        }
+    }
     private func connectViewToAU() {
         guard needsConnection, let paramTree = audioUnitCreated?.parameterTree else { return }
 
@@ -46,6 +46,7 @@ public class AUv3Intensifier: AUAudioUnit {
         ]
     }
 
+    // Mirrored in IntensifierPresets.hpp for the offline tools.
     private let factoryPresetValues:[(
         inputAmount: AUValue,
         attackAmount: AUValue,
@@ -149,8 +150,9 @@ public class AUv3Intensifier: AUAudioUnit {
         kernelAdapter.allocateRenderResources()
     }
 
+    // Mono, stereo, 5.1 and 7.1, always with as many outputs as inputs.
     public override var channelCapabilities: [NSNumber]? {
-        return [1, 1, 2, 2];
+        return [1, 1, 2, 2, 6, 6, 8, 8];
     }
 
     
@@ -164,6 +166,22 @@ public class AUv3Intensifier: AUAudioUnit {
         return kernelAdapter.internalRenderBlock()
     }
 
+    // Metering for the view; leave it off while nothing shows the meters.
+    public var meteringEnabled: Bool {
+        get { return kernelAdapter.meteringEnabled }
+        set { kernelAdapter.meteringEnabled = newValue }
+    }
+
+    public func readMeter() -> IntensifierMeterReading? {
+        var reading = IntensifierMeterReading()
+        return kernelAdapter.readMeter(&reading) ? reading : nil
+    }
+
+    // The lookahead delay keeps sounding after the input stops.
+    public override var tailTime: TimeInterval {
+        return kernelAdapter.tailTime
+    }
+
     // Boolean indicating that this AU can process the input audio in-place
     // in the input buffer, without requiring a separate output buffer.
     public override var canProcessInPlace: Bool {
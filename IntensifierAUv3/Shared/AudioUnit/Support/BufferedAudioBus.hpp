@@ -106,6 +106,47 @@ struct BufferedInputBus : BufferedAudioBus {
         return pullInputBlock(actionFlags, timestamp, frameCount, inputBusNumber, mutableAudioBufferList);
     }
 
+    /*
+     Like pullInput(), but offers the pullInputBlock the caller's buffers
+     instead of this bus's own, for cycles longer than maxFrames. They must
+     hold frameCount frames and have this bus's layout; see
+     canPullInputInto().
+     */
+    AUAudioUnitStatus pullInputInto(AudioBufferList const* buffers,
+                                    AudioUnitRenderActionFlags *actionFlags,
+                                    AudioTimeStamp const* timestamp,
+                                    AVAudioFrameCount frameCount,
+                                    NSInteger inputBusNumber,
+                                    AURenderPullInputBlock pullInputBlock) {
+        if (pullInputBlock == nullptr) {
+            return kAudioUnitErr_NoConnection;
+        }
+
+        UInt32 byteSize = frameCount * sizeof(float);
+        mutableAudioBufferList->mNumberBuffers = originalAudioBufferList->mNumberBuffers;
+
+        for (UInt32 i = 0; i < originalAudioBufferList->mNumberBuffers; ++i) {
+            mutableAudioBufferList->mBuffers[i].mNumberChannels = originalAudioBufferList->mBuffers[i].mNumberChannels;
+            mutableAudioBufferList->mBuffers[i].mData = buffers->mBuffers[i].mData;
+            mutableAudioBufferList->mBuffers[i].mDataByteSize = byteSize;
+        }
+
+        return pullInputBlock(actionFlags, timestamp, frameCount, inputBusNumber, mutableAudioBufferList);
+    }
+
+    // Whether pullInputInto() can pull frameCount frames into buffers.
+    bool canPullInputInto(AudioBufferList const* buffers, AVAudioFrameCount frameCount) const {
+        if (buffers->mNumberBuffers != originalAudioBufferList->mNumberBuffers) {
+            return false;
+        }
+        for (UInt32 i = 0; i < buffers->mNumberBuffers; ++i) {
+            if (buffers->mBuffers[i].mData == nullptr || buffers->mBuffers[i].mDataByteSize < frameCount * sizeof(float)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     /*
      prepareInputBufferList populates the mutableAudioBufferList with the data
      pointers from the originalAudioBufferList.
@@ -0,0 +1,70 @@
+#ifndef DSPArena_h
+#define DSPArena_h
+#include <stddef.h>
+#include <stdlib.h>
+
+/*
+ DSPArena
+ One cache-line aligned block of memory that a kernel carves its sample
+ buffers out of. Size it once, outside the render thread, with reserve();
+ then rewind() and take() hand out the same addresses in the same order
+ without allocating.
+ */
+class DSPArena {
+public:
+    static const size_t kAlignment = 64;
+
+    DSPArena() {}
+    DSPArena(const DSPArena&) = delete;
+    DSPArena& operator=(const DSPArena&) = delete;
+    ~DSPArena() { free(memory); }
+
+    // Bytes take() uses for count elements of T, including alignment padding.
+    template <typename T>
+    static size_t bytesFor(size_t count) {
+        return (count * sizeof(T) + kAlignment - 1) & ~(kAlignment - 1);
+    }
+
+    /*
+     Makes room for at least byteCount bytes. Allocates only when the arena
+     is too small, so this is real-time safe once it has been sized for the
+     largest configuration. Returns false if the allocation fails.
+     */
+    bool reserve(size_t byteCount) {
+        if (byteCount <= capacity) {
+            return true;
+        }
+        void* newMemory = nullptr;
+        if (posix_memalign(&newMemory, kAlignment, byteCount) != 0) {
+            return false;
+        }
+        free(memory);
+        memory = static_cast<char*>(newMemory);
+        capacity = byteCount;
+        used = 0;
+        return true;
+    }
+
+    // Starts handing out memory from the beginning again.
+    void rewind() { used = 0; }
+
+    // Returns count elements of T, aligned to a cache line, or nullptr if the arena is full.
+    template <typename T>
+    T* take(size_t count) {
+        size_t bytes = bytesFor<T>(count);
+        if (memory == nullptr || bytes > capacity - used) {
+            return nullptr;
+        }
+        T* result = reinterpret_cast<T*>(memory + used);
+        used += bytes;
+        return result;
+    }
+
+    size_t getCapacity() const { return capacity; }
+
+private:
+    char* memory = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;
+};
+#endif /* DSPArena_h */
@@ -1,32 +1,213 @@
 #ifndef DSPKernel_h
 #define DSPKernel_h
-#import <AudioToolbox/AudioToolbox.h>
-#import <algorithm>
-
+#include "DSPTypes.hpp"
+#include "ParameterSchedule.hpp"
+#include "RenderStats.hpp"
+#include <algorithm>
 
 template <typename T>
 T clamp(T input, T low, T high) {
     return std::min(std::max(input, low), high);
 }
 
-// Put your DSP code into a subclass of DSPKernel.
+/*
+ Put your DSP code into a subclass of DSPKernel, passing the subclass as
+ Kernel (CRTP). It provides
+   void process(AUAudioFrameCount frameCount, AUAudioFrameCount bufferOffset);
+   void startRamp(AUParameterAddress address, AUValue value, AUAudioFrameCount duration);
+ and may hide handleMIDIEvent(). processWithEvents() calls them directly,
+ with no virtual dispatch, so they can be inlined into the render loop.
+ */
+template <typename Kernel>
 class DSPKernel {
 public:
-    virtual void process(AUAudioFrameCount frameCount, AUAudioFrameCount bufferOffset) = 0;
-    virtual void startRamp(AUParameterAddress address, AUValue value, AUAudioFrameCount duration) = 0;
-
-    // Override to handle MIDI events.
-    virtual void handleMIDIEvent(AUMIDIEvent const& midiEvent) {}
+    // Hide to handle MIDI events.
+    void handleMIDIEvent(AUMIDIEvent const& midiEvent) {}
 
-    void processWithEvents(AudioTimeStamp const* timestamp, AUAudioFrameCount frameCount, AURenderEvent const* events, AUMIDIOutputEventBlock midiOut);
+    /*
+     Renders frameCount frames, handling the events from events up to, not
+     including, eventsEnd. A caller that renders a host cycle in pieces
+     passes each piece the events that fall in it, see
+     IntensifierDSPKernelAdapter.
+     */
+    void processWithEvents(AudioTimeStamp const* timestamp, AUAudioFrameCount frameCount, AURenderEvent const* events, AUMIDIOutputEventBlock midiOut, AURenderEvent const* eventsEnd = nullptr);
+    /*
+     Whether processWithEvents() hands parameter events to the kernel
+     through parameterSchedule instead of splitting the cycle at each one.
+     Only kernels whose process() drains the schedule may turn it on.
+     */
+    void setSchedulesParameterEvents(bool shouldSchedule) {
+        schedulesParameterEvents = shouldSchedule;
+    }
+    bool getSchedulesParameterEvents() const {
+        return schedulesParameterEvents;
+    }
     AUAudioFrameCount maximumFramesToRender() const { return maxFramesToRender; }
     void setMaximumFramesToRender(const AUAudioFrameCount &maxFrames) {
         maxFramesToRender = maxFrames;
     }
+#if INTENSIFIER_RENDER_STATS
+    // Render timing, see RenderStats. Safe to read from any thread.
+    RenderStats& getRenderStats() { return renderStats; }
+#endif
+protected:
+#if INTENSIFIER_RENDER_STATS
+    RenderStats renderStats;
+#endif
+    // This cycle's parameter events, while schedulesParameterEvents is on.
+    ParameterSchedule parameterSchedule;
+    // Applies the scheduled events due at or before frame that have not been applied yet.
+    void applyScheduledEvents(AUAudioFrameCount frame);
 private:
+    Kernel& kernel() { return static_cast<Kernel&>(*this); }
     void handleOneEvent(AURenderEvent const* event);
-    void performAllSimultaneousEvents(AUEventSampleTime now, AURenderEvent const*& event, AUMIDIOutputEventBlock midiOut);
+    void performAllSimultaneousEvents(AUEventSampleTime now, AURenderEvent const*& event, AURenderEvent const* eventsEnd, AUMIDIOutputEventBlock midiOut);
+    void processWithScheduledEvents(AUEventSampleTime now, AUAudioFrameCount frameCount, AURenderEvent const* events, AURenderEvent const* eventsEnd, AUMIDIOutputEventBlock midiOut);
+
+    bool schedulesParameterEvents = false;
 
     AUAudioFrameCount maxFramesToRender = 512;
 };
+
+template <typename Kernel>
+void DSPKernel<Kernel>::handleOneEvent(AURenderEvent const *event)
+{
+    switch (event->head.eventType) {
+        case AURenderEventParameter:
+        case AURenderEventParameterRamp: {
+            AUParameterEvent const& paramEvent = event->parameter;
+
+            kernel().startRamp(paramEvent.parameterAddress, paramEvent.value, paramEvent.rampDurationSampleFrames);
+            break;
+        }
+
+        case AURenderEventMIDI:
+            kernel().handleMIDIEvent(event->MIDI);
+            break;
+
+        default:
+            break;
+    }
+}
+
+template <typename Kernel>
+void DSPKernel<Kernel>::performAllSimultaneousEvents(AUEventSampleTime now, AURenderEvent const *&event, AURenderEvent const *eventsEnd, AUMIDIOutputEventBlock midiOut)
+{
+    do {
+        handleOneEvent(event);
+
+        if (event->head.eventType == AURenderEventMIDI && midiOut)
+        {
+            midiOut(now, 0, event->MIDI.length, event->MIDI.data);
+        }
+
+        // Go to next event.
+        event = event->head.next;
+
+        // While event is not the end and is simultaneous (or late).
+    } while (event != eventsEnd && event->head.eventSampleTime <= now);
+}
+
+/**
+ This function handles the event list processing and rendering loop for you.
+ Call it inside your internalRenderBlock.
+ */
+template <typename Kernel>
+void DSPKernel<Kernel>::processWithEvents(AudioTimeStamp const *timestamp, AUAudioFrameCount frameCount, AURenderEvent const *events, AUMIDIOutputEventBlock midiOut, AURenderEvent const *eventsEnd)
+{
+    INTENSIFIER_STATS_CALLBACK(renderStats, frameCount);
+
+    AUEventSampleTime now = AUEventSampleTime(timestamp->mSampleTime);
+    if (schedulesParameterEvents) {
+        processWithScheduledEvents(now, frameCount, events, eventsEnd, midiOut);
+        return;
+    }
+    AUAudioFrameCount framesRemaining = frameCount;
+    AURenderEvent const *event = events;
+
+    while (framesRemaining > 0) {
+        // If there are no more events, we can process the entire remaining segment and exit.
+        if (event == eventsEnd) {
+            AUAudioFrameCount const bufferOffset = frameCount - framesRemaining;
+            kernel().process(framesRemaining, bufferOffset);
+            return;
+        }
+
+        // **** start late events late.
+        auto timeZero = AUEventSampleTime(0);
+        auto headEventTime = event->head.eventSampleTime;
+        AUAudioFrameCount const framesThisSegment = AUAudioFrameCount(std::max(timeZero, headEventTime - now));
+
+        // Compute everything before the next event.
+        if (framesThisSegment > 0) {
+            AUAudioFrameCount const bufferOffset = frameCount - framesRemaining;
+            kernel().process(framesThisSegment, bufferOffset);
+
+            // Advance frames.
+            framesRemaining -= framesThisSegment;
+
+            // Advance time.
+            now += AUEventSampleTime(framesThisSegment);
+        }
+
+        performAllSimultaneousEvents(now, event, eventsEnd, midiOut);
+    }
+}
+
+/**
+ processWithEvents() for kernels that schedule parameter events. Parameter
+ events go into parameterSchedule, to be applied by process() at their
+ frames, so dense automation does not cut the cycle into tiny segments.
+ The cycle is only split at MIDI events and when the schedule fills up.
+ */
+template <typename Kernel>
+void DSPKernel<Kernel>::processWithScheduledEvents(AUEventSampleTime now, AUAudioFrameCount frameCount, AURenderEvent const *events, AURenderEvent const *eventsEnd, AUMIDIOutputEventBlock midiOut)
+{
+    parameterSchedule.clear();
+    AUAudioFrameCount framesDone = 0;
+
+    for (AURenderEvent const *event = events; event != eventsEnd; event = event->head.next) {
+        // Late events apply at the start of the cycle, ones past its end after it.
+        AUEventSampleTime offset = clamp(event->head.eventSampleTime - now, AUEventSampleTime(0), AUEventSampleTime(frameCount));
+        AUAudioFrameCount frame = std::max(AUAudioFrameCount(offset), framesDone);
+        bool isParameterEvent = event->head.eventType == AURenderEventParameter || event->head.eventType == AURenderEventParameterRamp;
+        if (isParameterEvent && !parameterSchedule.isFull()) {
+            AUParameterEvent const& paramEvent = event->parameter;
+            parameterSchedule.add({ frame, paramEvent.parameterAddress, paramEvent.value, paramEvent.rampDurationSampleFrames });
+            continue;
+        }
+
+        // Render up to the event and apply everything scheduled before it, in order.
+        if (frame > framesDone) {
+            kernel().process(frame - framesDone, framesDone);
+            framesDone = frame;
+        }
+        applyScheduledEvents(frame);
+        parameterSchedule.compact();
+
+        if (isParameterEvent) {
+            AUParameterEvent const& paramEvent = event->parameter;
+            parameterSchedule.add({ frame, paramEvent.parameterAddress, paramEvent.value, paramEvent.rampDurationSampleFrames });
+        } else {
+            handleOneEvent(event);
+            if (event->head.eventType == AURenderEventMIDI && midiOut) {
+                midiOut(now + AUEventSampleTime(frame), 0, event->MIDI.length, event->MIDI.data);
+            }
+        }
+    }
+
+    if (frameCount > framesDone) {
+        kernel().process(frameCount - framesDone, framesDone);
+    }
+    applyScheduledEvents(frameCount);
+}
+
+template <typename Kernel>
+void DSPKernel<Kernel>::applyScheduledEvents(AUAudioFrameCount frame)
+{
+    ParameterSchedule::Event event;
+    while (parameterSchedule.pop(frame, event)) {
+        kernel().startRamp(event.address, event.value, event.rampDuration);
+    }
+}
 #endif /* DSPKernel_h */
@@ -0,0 +1,67 @@
+#ifndef DSPTypes_h
+#define DSPTypes_h
+/*
+ DSPTypes
+ The Core Audio types used by the DSP core. On Apple platforms they come from
+ AudioToolbox. Elsewhere the same names are defined here, with the fields the
+ core uses, so the kernels build with any C++14 compiler.
+ */
+#if defined(__APPLE__)
+#include <AudioToolbox/AudioToolbox.h>
+#else
+#include <stdint.h>
+
+typedef uint32_t AUAudioFrameCount;
+typedef float AUValue;
+typedef uint64_t AUParameterAddress;
+typedef int64_t AUEventSampleTime;
+
+struct AudioTimeStamp {
+    double mSampleTime;
+};
+
+typedef enum AURenderEventType : uint8_t {
+    AURenderEventParameter = 1,
+    AURenderEventParameterRamp = 2,
+    AURenderEventMIDI = 8,
+    AURenderEventMIDISysEx = 9
+} AURenderEventType;
+
+union AURenderEvent;
+
+struct AURenderEventHeader {
+    union AURenderEvent *next;
+    AUEventSampleTime eventSampleTime;
+    AURenderEventType eventType;
+    uint8_t reserved;
+};
+
+struct AUParameterEvent {
+    union AURenderEvent *next;
+    AUEventSampleTime eventSampleTime;
+    AURenderEventType eventType;
+    uint8_t reserved[3];
+    AUAudioFrameCount rampDurationSampleFrames;
+    AUParameterAddress parameterAddress;
+    AUValue value;
+};
+
+struct AUMIDIEvent {
+    union AURenderEvent *next;
+    AUEventSampleTime eventSampleTime;
+    AURenderEventType eventType;
+    uint8_t cable;
+    uint16_t length;
+    uint8_t data[3];
+};
+
+typedef union AURenderEvent {
+    AURenderEventHeader head;
+    AUParameterEvent parameter;
+    AUMIDIEvent MIDI;
+} AURenderEvent;
+
+// Without Objective-C blocks, MIDI output goes through a plain function pointer.
+typedef int32_t (*AUMIDIOutputEventBlock)(AUEventSampleTime eventSampleTime, uint8_t cable, long length, const uint8_t *midiBytes);
+#endif
+#endif /* DSPTypes_h */
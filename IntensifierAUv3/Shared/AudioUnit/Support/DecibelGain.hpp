@@ -0,0 +1,70 @@
+#ifndef DecibelGain_h
+#define DecibelGain_h
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ DecibelGain
+ Converts decibels to linear amplitude without calling pow(), so it is cheap
+ enough to run per sample and simple enough for the compiler to vectorize.
+
+ 10^(dB / 20) is evaluated as 2^x with x = dB * log2(10) / 20. The integer
+ part of x is written straight into the exponent bits of the result and 2^f,
+ f in [0, 1), comes from a degree 5 polynomial interpolated at the Chebyshev
+ nodes.
+
+ Error bounds, relative to pow(10., dB / 20.0): the polynomial alone is
+ within 1.02e-7 of 2^f. Evaluated in float the result is within 2.5e-7 for
+ |dB| <= 24, 5e-7 for |dB| <= 60 and 9e-7 for |dB| <= 120 (under 0.00001 dB).
+ The error grows to about 3e-6 at the ends of the range, where rounding
+ dB * log2(10) / 20 to float dominates. Results below 2^-126 (about -758.6 dB)
+ and NaN return 0; results above 2^127 saturate.
+ */
+namespace DecibelGain
+{
+    constexpr float kLog2Of10Over20 = 0.16609640474436813f;
+    constexpr float kMinExponent = -126.0f;
+    constexpr float kMaxExponent = 127.0f;
+
+    // 2^f on [0, 1), lowest order first.
+    constexpr float kExp2Coefficients[6] = {
+        0.9999998983500245f,
+        0.6931544896632286f,
+        0.24014181820146044f,
+        0.05586033707720827f,
+        0.00894959042337237f,
+        0.0018937540581920975f
+    };
+
+    static inline float toAmplitude(float dB)
+    {
+        float x = dB * kLog2Of10Over20;
+        float clamped = x > kMinExponent ? x : kMinExponent;
+        clamped = clamped < kMaxExponent ? clamped : kMaxExponent;
+
+        float whole = floorf(clamped);
+        float f = clamped - whole;
+        float fraction = kExp2Coefficients[5];
+        fraction = fraction * f + kExp2Coefficients[4];
+        fraction = fraction * f + kExp2Coefficients[3];
+        fraction = fraction * f + kExp2Coefficients[2];
+        fraction = fraction * f + kExp2Coefficients[1];
+        fraction = fraction * f + kExp2Coefficients[0];
+
+        int32_t exponentBits = (int32_t(whole) + 127) << 23;
+        float scale;
+        memcpy(&scale, &exponentBits, sizeof(scale));
+
+        return x > kMinExponent ? fraction * scale : 0.0f;
+    }
+
+    // Block entry point. dB and amplitude may be the same buffer.
+    static inline void toAmplitude(const float *dB, float *amplitude, int count)
+    {
+        for (int i = 0; i < count; ++i) {
+            amplitude[i] = toAmplitude(dB[i]);
+        }
+    }
+}
+#endif /* DecibelGain_h */
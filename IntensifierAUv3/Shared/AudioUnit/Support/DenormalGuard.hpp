@@ -0,0 +1,73 @@
+#ifndef DenormalGuard_h
+#define DenormalGuard_h
+#include <stdint.h>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define DENORMAL_GUARD_SSE 1
+#elif defined(__aarch64__) || (defined(__arm__) && defined(__ARM_FP))
+#define DENORMAL_GUARD_ARM 1
+#endif
+
+/*
+ DenormalGuard
+ Makes the current thread flush subnormal floats to zero for its lifetime
+ and restores the previous mode when it goes out of scope. Decaying
+ envelopes and input tails otherwise drift into the subnormal range, where
+ every operation can cost a hundred cycles or more.
+ On x86 this sets FTZ and DAZ in MXCSR; on ARM it sets FZ in FPCR (64 bit)
+ or FPSCR (32 bit), which covers both. Elsewhere it does nothing.
+ */
+class DenormalGuard {
+public:
+    explicit DenormalGuard(bool enabled = true) {
+        if (!enabled) {
+            return;
+        }
+        saved = readMode();
+        uintptr_t flushing = saved | kFlushBits;
+        if (flushing != saved) {
+            writeMode(flushing);
+            restore = true;
+        }
+    }
+    DenormalGuard(const DenormalGuard&) = delete;
+    DenormalGuard& operator=(const DenormalGuard&) = delete;
+    ~DenormalGuard() {
+        if (restore) {
+            writeMode(saved);
+        }
+    }
+
+private:
+#if DENORMAL_GUARD_SSE
+    static const uintptr_t kFlushBits = 0x8040; // FTZ | DAZ
+    static uintptr_t readMode() { return _mm_getcsr(); }
+    static void writeMode(uintptr_t mode) { _mm_setcsr(unsigned(mode)); }
+#elif DENORMAL_GUARD_ARM
+    static const uintptr_t kFlushBits = uintptr_t(1) << 24; // FZ
+    static uintptr_t readMode() {
+        uintptr_t mode;
+#if defined(__aarch64__)
+        __asm__ __volatile__("mrs %0, fpcr" : "=r"(mode));
+#else
+        __asm__ __volatile__("vmrs %0, fpscr" : "=r"(mode));
+#endif
+        return mode;
+    }
+    static void writeMode(uintptr_t mode) {
+#if defined(__aarch64__)
+        __asm__ __volatile__("msr fpcr, %0" : : "r"(mode));
+#else
+        __asm__ __volatile__("vmsr fpscr, %0" : : "r"(mode));
+#endif
+    }
+#else
+    static const uintptr_t kFlushBits = 0;
+    static uintptr_t readMode() { return 0; }
+    static void writeMode(uintptr_t) {}
+#endif
+
+    uintptr_t saved = 0;
+    bool restore = false;
+};
+#endif /* DenormalGuard_h */
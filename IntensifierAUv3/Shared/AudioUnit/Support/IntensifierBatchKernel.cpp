@@ -0,0 +1,11 @@
+#include "IntensifierBatchKernel.hpp"
+
+// Out-of-line definitions for the constants, needed when they are odr-used before C++17.
+constexpr int IntensifierBatchKernel::kLanes;
+constexpr int IntensifierBatchKernel::kMaxChannels;
+constexpr int IntensifierBatchKernel::kBlockFrames;
+constexpr int IntensifierBatchKernel::kParameterCount;
+constexpr int IntensifierBatchKernel::kMaxInstances;
+constexpr int IntensifierBatchKernel::kControlRateFrames;
+constexpr int IntensifierBatchKernel::kSegments;
+constexpr AUValue IntensifierBatchKernel::kDefaultParameters[IntensifierBatchKernel::kParameterCount];
@@ -0,0 +1,638 @@
+#ifndef IntensifierBatchKernel_h
+#define IntensifierBatchKernel_h
+#include "IntensifierDSPKernel.hpp"
+#include <functional>
+#include <memory>
+#include <vector>
+
+/*
+ IntensifierBatchKernel
+ Runs many independent Intensifier instances, such as one per track of a
+ session, in one pass. Every channel of every instance is a lane; lanes are
+ grouped kLanes at a time into packs whose detector, slide and delay state
+ is interleaved lane by lane (array of structures of arrays), so each stage
+ of the pipeline processes a pack's lanes side by side, one SIMD lane per
+ channel, whichever instances they belong to.
+
+ Each instance has its own parameters and renders exactly what an
+ IntensifierDSPKernel with the same parameters renders for the same buffer
+ sizes, with full-rate detectors. The batch has no bypass, metering,
+ silence skipping or detector decimation.
+
+ Threads: one control thread calls init(), addInstance(), removeInstance(),
+ setParameter() and getParameter(); one render thread calls the rest.
+ Adding and removing instances only queues a command for the render
+ thread, which applies it in applyPendingChanges(), so neither side waits
+ for the other. A render cycle is applyPendingChanges(), then setBuffers()
+ for each active instance, then process().
+ */
+class IntensifierBatchKernel {
+public:
+    static constexpr int kLanes = 8;
+    static constexpr int kMaxChannels = IntensifierDSPKernel::kMaxChannels;
+    static constexpr int kBlockFrames = IntensifierDSPKernel::kBlockFrames;
+    static constexpr int kParameterCount = IntensifierDSPKernel::kParameterCount;
+    // Largest instance count init() accepts; bounds the command queues.
+    static constexpr int kMaxInstances = 256;
+
+    /*
+     Control thread, while the render thread is not running: sizes the
+     batch for maxInstances instances with maxLanes channels between them,
+     at sampleRate, and removes every instance. Allocates.
+     */
+    void init(int maxInstances, int maxLanes, double inSampleRate)
+    {
+        instanceCapacity = clamp(maxInstances, 0, int(kMaxInstances));
+        packCount = (std::max(maxLanes, 0) + kLanes - 1) / kLanes;
+        sampleRate = float(inSampleRate);
+        dezipperRampDuration = (AUAudioFrameCount)floor(0.02 * sampleRate);
+
+        instances.reset(new Instance[instanceCapacity]);
+        freeInstances.clear();
+        for (int instance = instanceCapacity - 1; instance >= 0; --instance) {
+            freeInstances.push_back(instance);
+        }
+        freeLanes.clear();
+        for (int lane = packCount * kLanes - 1; lane >= 0; --lane) {
+            freeLanes.push_back(lane);
+        }
+        Command command;
+        while (commands.pop(command)) {}
+        int released;
+        while (releasedInstances.pop(released)) {}
+
+        delayFrames = size_t(lround(IntensifierDSPKernel::kLookaheadMs * sampleRate / 1000.0));
+        delayCapacity = LookaheadDelay::storageSize(delayFrames, kBlockFrames);
+        attackWindow.init(IntensifierDSPKernel::kAttackRMSPoints);
+        releaseWindow.init(IntensifierDSPKernel::kReleaseRMSPoints);
+        arena.reserve(packCount * (DSPArena::bytesFor<double>(attackWindow.points * kLanes)
+                                   + DSPArena::bytesFor<double>(releaseWindow.points * kLanes)
+                                   + DSPArena::bytesFor<float>(delayCapacity * kLanes)));
+        arena.rewind();
+        packs.assign(packCount, Pack());
+        for (Pack& pack : packs) {
+            pack.attackWindow = arena.take<double>(attackWindow.points * kLanes);
+            pack.releaseWindow = arena.take<double>(releaseWindow.points * kLanes);
+            pack.delay = arena.take<float>(delayCapacity * kLanes);
+            for (int lane = 0; lane < kLanes; ++lane) {
+                pack.clearLane(lane, attackWindow.points, releaseWindow.points, delayCapacity);
+            }
+        }
+        attackWindow.index = 0;
+        releaseWindow.index = 0;
+        delayWriteIndex = 0;
+    }
+
+    /*
+     Control thread. Adds an instance with channelCount channels and the
+     given kParameterCount parameter values, or the defaults if parameters
+     is null. Returns its id, or -1 if the batch is out of instances or
+     lanes. It renders once the render thread's next applyPendingChanges()
+     picks it up.
+     */
+    int addInstance(int channelCount, const AUValue* parameters = nullptr)
+    {
+        reclaimReleased();
+        if (channelCount < 1 || channelCount > kMaxChannels || freeInstances.empty() || int(freeLanes.size()) < channelCount) {
+            return -1;
+        }
+        int id = freeInstances.back();
+        Instance& instance = instances[id];
+        instance.channelCount = channelCount;
+        for (int channel = 0; channel < channelCount; ++channel) {
+            instance.lanes[channel] = freeLanes.back();
+            freeLanes.pop_back();
+        }
+        for (int address = 0; address < kParameterCount; ++address) {
+            AUValue value = parameters != nullptr ? parameters[address] : kDefaultParameters[address];
+            ParameterRamper& ramper = instance.rampers[address];
+            ramper.setUIValue(IntensifierDSPKernel::clampParameter(address, value));
+            ramper.init();
+            ramper.reset();
+        }
+        if (!commands.push({ Command::kAdd, id })) {
+            releaseLanes(instance);
+            return -1;
+        }
+        freeInstances.pop_back();
+        instance.added = true;
+        return id;
+    }
+
+    // Control thread. Stops rendering the instance; its id may be reused by a later addInstance().
+    bool removeInstance(int id)
+    {
+        if (!isAdded(id) || !commands.push({ Command::kRemove, id })) {
+            return false;
+        }
+        instances[id].added = false;
+        return true;
+    }
+
+    // Control thread. Ramps to the new value over the dezipper time, like IntensifierDSPKernel.
+    void setParameter(int id, AUParameterAddress address, AUValue value)
+    {
+        if (isAdded(id) && address < AUParameterAddress(kParameterCount)) {
+            instances[id].rampers[address].setUIValue(IntensifierDSPKernel::clampParameter(address, value));
+        }
+    }
+    AUValue getParameter(int id, AUParameterAddress address) const
+    {
+        if (isAdded(id) && address < AUParameterAddress(kParameterCount)) {
+            return instances[id].rampers[address].getUIValue();
+        }
+        return 0.0;
+    }
+
+    /*
+     Render thread, at the start of a cycle: activates the instances added
+     and deactivates the ones removed since the last call.
+     */
+    void applyPendingChanges()
+    {
+        Command command;
+        while (commands.pop(command)) {
+            Instance& instance = instances[command.instance];
+            bool add = command.type == Command::kAdd;
+            instance.active = add;
+            for (int channel = 0; channel < instance.channelCount; ++channel) {
+                int lane = instance.lanes[channel];
+                Pack& pack = packs[lane / kLanes];
+                pack.laneInstance[lane % kLanes] = add ? command.instance : -1;
+                pack.laneChannel[lane % kLanes] = channel;
+                pack.activeLanes += add ? 1 : -1;
+                if (add) {
+                    pack.clearLane(lane % kLanes, attackWindow.points, releaseWindow.points, delayCapacity);
+                }
+            }
+            if (add) {
+                instance.attackTimeValue = -1.0;
+                instance.releaseTimeValue = -1.0;
+                std::fill(instance.inBuffers, instance.inBuffers + kMaxChannels, nullptr);
+                std::fill(instance.outBuffers, instance.outBuffers + kMaxChannels, nullptr);
+            } else {
+                releasedInstances.push(command.instance);
+            }
+        }
+    }
+    // Render thread. True once applyPendingChanges() has picked up the instance's addInstance().
+    bool isActive(int id) const
+    {
+        return id >= 0 && id < instanceCapacity && instances[id].active;
+    }
+    // Render thread. Parameter automation for one instance.
+    void startRamp(int id, AUParameterAddress address, AUValue value, AUAudioFrameCount duration)
+    {
+        if (isActive(id) && address < AUParameterAddress(kParameterCount)) {
+            instances[id].rampers[address].startRamp(IntensifierDSPKernel::clampParameter(address, value), duration);
+        }
+    }
+    /*
+     Render thread. Planar buffers, one per channel of the instance, read
+     and written from their start by process(). Input and output may be the
+     same buffers. Only active instances take buffers; one without input
+     buffers renders silence in, one without output buffers is processed
+     but not written.
+     */
+    void setBuffers(int id, const float* const* inBuffers, float* const* outBuffers)
+    {
+        if (!isActive(id)) {
+            return;
+        }
+        Instance& instance = instances[id];
+        for (int channel = 0; channel < instance.channelCount; ++channel) {
+            instance.inBuffers[channel] = inBuffers != nullptr ? inBuffers[channel] : nullptr;
+            instance.outBuffers[channel] = outBuffers != nullptr ? outBuffers[channel] : nullptr;
+        }
+    }
+
+    // Render thread. Renders frameCount frames of every active instance.
+    void process(AUAudioFrameCount frameCount)
+    {
+        DenormalGuard denormalGuard;
+
+        for (int id = 0; id < instanceCapacity; ++id) {
+            Instance& instance = instances[id];
+            if (instance.active) {
+                instance.parametersRamping = ParameterRamper::dezipperCheck(instance.rampersList, kParameterCount, dezipperRampDuration);
+            }
+        }
+
+        for (AUAudioFrameCount done = 0; done < frameCount; done += kBlockFrames) {
+            int blockFrames = int(std::min(frameCount - done, AUAudioFrameCount(kBlockFrames)));
+            for (int id = 0; id < instanceCapacity; ++id) {
+                if (instances[id].active) {
+                    updateInstance(instances[id], blockFrames);
+                }
+            }
+            for (Pack& pack : packs) {
+                if (pack.activeLanes > 0) {
+                    processPack(pack, blockFrames, int(done));
+                }
+            }
+            attackWindow.index = (attackWindow.index + blockFrames) % attackWindow.points;
+            releaseWindow.index = (releaseWindow.index + blockFrames) % releaseWindow.points;
+            delayWriteIndex = (delayWriteIndex + blockFrames) & (delayCapacity - 1);
+        }
+
+        // Squelch any blowups once per cycle.
+        for (Pack& pack : packs) {
+            for (int lane = 0; lane < kLanes; ++lane) {
+                pack.attackSlideUp[lane] = convertBadValuesToZero(pack.attackSlideUp[lane]);
+                pack.attackSlideDown[lane] = convertBadValuesToZero(pack.attackSlideDown[lane]);
+                pack.releaseSlideDown[lane] = convertBadValuesToZero(pack.releaseSlideDown[lane]);
+            }
+        }
+    }
+
+private:
+    static constexpr int kControlRateFrames = IntensifierDSPKernel::kDefaultControlRateFrames;
+    static constexpr int kSegments = (kBlockFrames + kControlRateFrames - 1) / kControlRateFrames;
+    static constexpr AUValue kDefaultParameters[kParameterCount] = { 0.0, 0.0, 0.0, 20.0, 1.0, 0.0 };
+
+    struct Instance {
+        // Written by the control thread while the instance is free, read by the render thread once added.
+        ParameterRamper rampers[kParameterCount] = {
+            {kDefaultParameters[0]}, {kDefaultParameters[1]}, {kDefaultParameters[2]},
+            {kDefaultParameters[3]}, {kDefaultParameters[4]}, {kDefaultParameters[5]}
+        };
+        ParameterRamper* const rampersList[kParameterCount] = {
+            &rampers[0], &rampers[1], &rampers[2], &rampers[3], &rampers[4], &rampers[5]
+        };
+        int channelCount = 0;
+        int lanes[kMaxChannels] = {};
+        bool added = false; // control thread only
+
+        // Render thread only.
+        bool active = false;
+        bool parametersRamping = false;
+        const float* inBuffers[kMaxChannels] = {};
+        float* outBuffers[kMaxChannels] = {};
+        // The current sub-block's parameters: per-frame values while they ramp, see updateInstance().
+        bool inputRamping = false;
+        bool amountsRamping = false;
+        float inputGainBlock[kBlockFrames];
+        float attackAmountBlock[kBlockFrames];
+        float releaseAmountBlock[kBlockFrames];
+        float outputAmountBlock[kBlockFrames];
+        float attackSlides[kSegments];
+        float releaseSlides[kSegments];
+        float attackTimeValue = -1.0;
+        float releaseTimeValue = -1.0;
+        float attackSlideSamples = 0.0;
+        float releaseSlideSamples = 0.0;
+    };
+
+    // Moving RMS windows of one length for every lane, see CycloneObjects::rmsaverage.
+    struct LaneWindow {
+        unsigned int points = 1;
+        double squareScale = 1.0;
+        float outputScale = 1.0;
+        unsigned int index = 0; // shared by every pack
+
+        void init(unsigned int pointCount) {
+            points = CycloneObjects::rmsaverage::storageSize(pointCount);
+            squareScale = CycloneObjects::rmsaverage::squareScaleFor(pointCount);
+            outputScale = CycloneObjects::rmsaverage::outputScaleFor(pointCount);
+        }
+    };
+
+    // kLanes lanes of state, interleaved: element [i * kLanes + lane].
+    struct Pack {
+        float attackSlideUp[kLanes] = {};
+        float attackSlideDown[kLanes] = {};
+        float releaseSlideDown[kLanes] = {};
+        double attackSum[kLanes] = {};
+        double releaseSum[kLanes] = {};
+        double* attackWindow = nullptr;
+        double* releaseWindow = nullptr;
+        float* delay = nullptr;
+        // Owner of each lane, or -1, and the channel of the owner it carries.
+        int laneInstance[kLanes];
+        int laneChannel[kLanes] = {};
+        int activeLanes = 0;
+
+        Pack() {
+            std::fill(laneInstance, laneInstance + kLanes, -1);
+        }
+
+        void clearLane(int lane, size_t attackPoints, size_t releasePoints, size_t delaySize) {
+            attackSlideUp[lane] = 0.0f;
+            attackSlideDown[lane] = 0.0f;
+            releaseSlideDown[lane] = 0.0f;
+            attackSum[lane] = 0.0;
+            releaseSum[lane] = 0.0;
+            for (size_t i = 0; i < attackPoints; ++i) {
+                attackWindow[i * kLanes + lane] = 0.0;
+            }
+            for (size_t i = 0; i < releasePoints; ++i) {
+                releaseWindow[i * kLanes + lane] = 0.0;
+            }
+            for (size_t i = 0; i < delaySize; ++i) {
+                delay[i * kLanes + lane] = 0.0f;
+            }
+        }
+    };
+
+    struct Command {
+        enum Type { kAdd, kRemove } type;
+        int instance;
+    };
+
+    bool isAdded(int id) const
+    {
+        return id >= 0 && id < instanceCapacity && instances[id].added;
+    }
+
+    // Control thread: takes back the instances and lanes the render thread has let go of.
+    void reclaimReleased()
+    {
+        int id;
+        while (releasedInstances.pop(id)) {
+            releaseLanes(instances[id]);
+            freeInstances.push_back(id);
+        }
+    }
+    // Control thread: returns an instance's lanes, keeping the lowest ones at the back so the active lanes stay packed.
+    void releaseLanes(Instance& instance)
+    {
+        for (int channel = 0; channel < instance.channelCount; ++channel) {
+            freeLanes.push_back(instance.lanes[channel]);
+        }
+        instance.channelCount = 0;
+        std::sort(freeLanes.begin(), freeLanes.end(), std::greater<int>());
+    }
+
+    void setSlideTimes(Instance& instance, float attackTime, float releaseTime)
+    {
+        instance.attackTimeValue = attackTime;
+        instance.releaseTimeValue = releaseTime;
+        instance.attackSlideSamples = CycloneObjects::slide::samples(float(attackTime * (sampleRate / 1000.0)));
+        instance.releaseSlideSamples = CycloneObjects::slide::samples(float(releaseTime * 1000 * (sampleRate / 1000.0)));
+    }
+
+    /*
+     Steps an instance's parameters through one sub-block, the way
+     IntensifierDSPKernel does: the gains as per-frame blocks while they
+     ramp, the slide lengths once per kControlRateFrames segment.
+     */
+    void updateInstance(Instance& instance, int frameCount)
+    {
+        ParameterRamper* rampers = instance.rampers;
+        bool ramping = instance.parametersRamping;
+        instance.inputRamping = ramping && rampers[IntensifierParamInputAmount].getAndStepBlock(instance.inputGainBlock, frameCount);
+        bool attackRamping = ramping && rampers[IntensifierParamAttackAmount].getAndStepBlock(instance.attackAmountBlock, frameCount);
+        bool releaseRamping = ramping && rampers[IntensifierParamReleaseAmount].getAndStepBlock(instance.releaseAmountBlock, frameCount);
+        bool outputRamping = ramping && rampers[IntensifierParamOutputAmount].getAndStepBlock(instance.outputAmountBlock, frameCount);
+        if (instance.inputRamping) {
+            DecibelGain::toAmplitude(instance.inputGainBlock, instance.inputGainBlock, frameCount);
+        }
+        instance.amountsRamping = attackRamping || releaseRamping || outputRamping;
+        if (instance.amountsRamping) {
+            if (!attackRamping) {
+                std::fill(instance.attackAmountBlock, instance.attackAmountBlock + frameCount, rampers[IntensifierParamAttackAmount].get());
+            }
+            if (!releaseRamping) {
+                std::fill(instance.releaseAmountBlock, instance.releaseAmountBlock + frameCount, rampers[IntensifierParamReleaseAmount].get());
+            }
+            if (!outputRamping) {
+                std::fill(instance.outputAmountBlock, instance.outputAmountBlock + frameCount, rampers[IntensifierParamOutputAmount].get());
+            }
+        }
+
+        ParameterRamper& attackTime = rampers[IntensifierParamAttackTime];
+        ParameterRamper& releaseTime = rampers[IntensifierParamReleaseTime];
+        int segmentCount = (frameCount + kControlRateFrames - 1) / kControlRateFrames;
+        if (!attackTime.isRamping() && !releaseTime.isRamping()) {
+            if (attackTime.get() != instance.attackTimeValue || releaseTime.get() != instance.releaseTimeValue) {
+                setSlideTimes(instance, attackTime.get(), releaseTime.get());
+            }
+            std::fill(instance.attackSlides, instance.attackSlides + segmentCount, instance.attackSlideSamples);
+            std::fill(instance.releaseSlides, instance.releaseSlides + segmentCount, instance.releaseSlideSamples);
+            return;
+        }
+        for (int segment = 0; segment < segmentCount; ++segment) {
+            int segmentFrames = std::min(kControlRateFrames, frameCount - segment * kControlRateFrames);
+            setSlideTimes(instance, attackTime.get(), releaseTime.get());
+            attackTime.stepBy(segmentFrames);
+            releaseTime.stepBy(segmentFrames);
+            instance.attackSlides[segment] = instance.attackSlideSamples;
+            instance.releaseSlides[segment] = instance.releaseSlideSamples;
+        }
+    }
+
+    /*
+     Runs one lane window over a sub-block of interleaved input, into
+     interleaved RMS: the squares are quantized in one pass, then swapped
+     into the window and summed frame by frame across the lanes.
+     */
+    void processWindow(LaneWindow& window, double* samples, double* sums, const float* in, float* out, int frameCount)
+    {
+        int sampleCount = frameCount * kLanes;
+        for (int sampleIndex = 0; sampleIndex < sampleCount; ++sampleIndex) {
+            squaresBlock[sampleIndex] = CycloneObjects::rmsaverage::quantizedSquare(in[sampleIndex], window.squareScale);
+        }
+        double laneSums[kLanes];
+        std::copy(sums, sums + kLanes, laneSums);
+        unsigned int index = window.index;
+        for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+            double* oldest = samples + size_t(index) * kLanes;
+            const double* squares = squaresBlock + frameIndex * kLanes;
+            float* frameOut = out + frameIndex * kLanes;
+            for (int lane = 0; lane < kLanes; ++lane) {
+                laneSums[lane] += squares[lane] - oldest[lane];
+                oldest[lane] = squares[lane];
+                frameOut[lane] = float(laneSums[lane]) * window.outputScale;
+            }
+            index = index + 1 == window.points ? 0 : index + 1;
+        }
+        std::copy(laneSums, laneSums + kLanes, sums);
+        for (int sampleIndex = 0; sampleIndex < sampleCount; ++sampleIndex) {
+            out[sampleIndex] = sqrtf(out[sampleIndex]);
+        }
+    }
+
+    /*
+     Renders one sub-block of a pack, stage by stage, over interleaved
+     scratch buffers: a frame's kLanes lanes sit side by side, so every
+     stage, recursive or not, runs across the lanes.
+     */
+    void processPack(Pack& pack, int frameCount, int bufferOffset)
+    {
+        int sampleCount = frameCount * kLanes;
+
+        // Per-lane parameters. Lanes whose instance ramps a gain take the per-frame path.
+        bool inputRamping = false;
+        bool amountsRamping = false;
+        for (int lane = 0; lane < kLanes; ++lane) {
+            int owner = pack.laneInstance[lane];
+            const Instance* instance = owner >= 0 ? &instances[owner] : nullptr;
+            if (instance == nullptr) {
+                laneInputGain[lane] = 0.0f;
+                laneAttackAmount[lane] = 0.0f;
+                laneReleaseAmount[lane] = 0.0f;
+                laneOutputAmount[lane] = 0.0f;
+                for (int segment = 0; segment < kSegments; ++segment) {
+                    laneAttackSlides[segment][lane] = 0.0f;
+                    laneReleaseSlides[segment][lane] = 0.0f;
+                }
+                continue;
+            }
+            const ParameterRamper* rampers = instance->rampers;
+            laneInputGain[lane] = DecibelGain::toAmplitude(rampers[IntensifierParamInputAmount].get());
+            laneAttackAmount[lane] = rampers[IntensifierParamAttackAmount].get() * 2.5;
+            laneReleaseAmount[lane] = rampers[IntensifierParamReleaseAmount].get() * 2.5;
+            laneOutputAmount[lane] = rampers[IntensifierParamOutputAmount].get();
+            for (int segment = 0; segment < kSegments; ++segment) {
+                laneAttackSlides[segment][lane] = instance->attackSlides[segment];
+                laneReleaseSlides[segment][lane] = instance->releaseSlides[segment];
+            }
+            inputRamping |= instance->inputRamping;
+            amountsRamping |= instance->amountsRamping;
+        }
+
+        // Input gain, gathered from the instances' planar buffers.
+        for (int lane = 0; lane < kLanes; ++lane) {
+            int owner = pack.laneInstance[lane];
+            const float* in = owner >= 0 ? instances[owner].inBuffers[pack.laneChannel[lane]] : nullptr;
+            if (in == nullptr) {
+                for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                    gainedBlock[frameIndex * kLanes + lane] = 0.0f;
+                }
+            } else if (inputRamping && instances[owner].inputRamping) {
+                const float* gain = instances[owner].inputGainBlock;
+                for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                    gainedBlock[frameIndex * kLanes + lane] = in[bufferOffset + frameIndex] * gain[frameIndex];
+                }
+            } else {
+                float gain = laneInputGain[lane];
+                for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                    gainedBlock[frameIndex * kLanes + lane] = in[bufferOffset + frameIndex] * gain;
+                }
+            }
+        }
+
+        // RMS detectors.
+        processWindow(attackWindow, pack.attackWindow, pack.attackSum, gainedBlock, attackRMSBlock, frameCount);
+        processWindow(releaseWindow, pack.releaseWindow, pack.releaseSum, gainedBlock, releaseRMSBlock, frameCount);
+
+        // Attack: slide up, keep only the part of the RMS above it, then slide down.
+        // Release: slide down, then keep only the part of the RMS below it.
+        for (int segment = 0, frameIndex = 0; frameIndex < frameCount; ++segment) {
+            const float* attackSlide = laneAttackSlides[segment];
+            const float* releaseSlide = laneReleaseSlides[segment];
+            int endFrame = std::min(frameCount, frameIndex + kControlRateFrames);
+            for (; frameIndex < endFrame; ++frameIndex) {
+                const float* attackRMS = attackRMSBlock + frameIndex * kLanes;
+                const float* releaseRMS = releaseRMSBlock + frameIndex * kLanes;
+                float* attackEnv = attackEnvBlock + frameIndex * kLanes;
+                float* releaseEnv = releaseEnvBlock + frameIndex * kLanes;
+                for (int lane = 0; lane < kLanes; ++lane) {
+                    float slideUp = CycloneObjects::slide::step(attackRMS[lane], pack.attackSlideUp[lane], attackSlide[lane], 0.0f);
+                    pack.attackSlideUp[lane] = slideUp;
+                    float attack = float(attackRMS[lane] >= slideUp) * (attackRMS[lane] - slideUp);
+                    pack.attackSlideDown[lane] = CycloneObjects::slide::step(attack, pack.attackSlideDown[lane], 0.0f, attackSlide[lane]);
+                    attackEnv[lane] = pack.attackSlideDown[lane];
+
+                    float slideDown = CycloneObjects::slide::step(releaseRMS[lane], pack.releaseSlideDown[lane], 0.0f, releaseSlide[lane]);
+                    pack.releaseSlideDown[lane] = slideDown;
+                    releaseEnv[lane] = float(releaseRMS[lane] <= slideDown) * (slideDown - releaseRMS[lane]);
+                }
+            }
+        }
+
+        // Gain in decibels, then amplitude.
+        if (amountsRamping) {
+            for (int lane = 0; lane < kLanes; ++lane) {
+                int owner = pack.laneInstance[lane];
+                if (owner < 0 || !instances[owner].amountsRamping) {
+                    for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                        int sampleIndex = frameIndex * kLanes + lane;
+                        gainBlock[sampleIndex] = attackEnvBlock[sampleIndex] * laneAttackAmount[lane] + releaseEnvBlock[sampleIndex] * laneReleaseAmount[lane] + laneOutputAmount[lane];
+                    }
+                    continue;
+                }
+                const Instance& instance = instances[owner];
+                for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                    int sampleIndex = frameIndex * kLanes + lane;
+                    float attackAmount = instance.attackAmountBlock[frameIndex] * 2.5;
+                    float releaseAmount = instance.releaseAmountBlock[frameIndex] * 2.5;
+                    gainBlock[sampleIndex] = attackEnvBlock[sampleIndex] * attackAmount + releaseEnvBlock[sampleIndex] * releaseAmount + instance.outputAmountBlock[frameIndex];
+                }
+            }
+        } else {
+            for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                for (int lane = 0; lane < kLanes; ++lane) {
+                    int sampleIndex = frameIndex * kLanes + lane;
+                    gainBlock[sampleIndex] = attackEnvBlock[sampleIndex] * laneAttackAmount[lane] + releaseEnvBlock[sampleIndex] * laneReleaseAmount[lane] + laneOutputAmount[lane];
+                }
+            }
+        }
+        DecibelGain::toAmplitude(gainBlock, gainBlock, sampleCount);
+
+        // Lookahead delay: write the sub-block, then read it back delayFrames later and apply the gain.
+        size_t mask = delayCapacity - 1;
+        for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+            float* slot = pack.delay + ((delayWriteIndex + frameIndex) & mask) * kLanes;
+            for (int lane = 0; lane < kLanes; ++lane) {
+                slot[lane] = gainedBlock[frameIndex * kLanes + lane];
+            }
+        }
+        for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+            const float* slot = pack.delay + ((delayWriteIndex - delayFrames + frameIndex) & mask) * kLanes;
+            for (int lane = 0; lane < kLanes; ++lane) {
+                gainBlock[frameIndex * kLanes + lane] *= slot[lane];
+            }
+        }
+
+        // Scatter back to the instances' planar buffers.
+        for (int lane = 0; lane < kLanes; ++lane) {
+            int owner = pack.laneInstance[lane];
+            float* out = owner >= 0 ? instances[owner].outBuffers[pack.laneChannel[lane]] : nullptr;
+            if (out == nullptr) {
+                continue;
+            }
+            for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                out[bufferOffset + frameIndex] = gainBlock[frameIndex * kLanes + lane];
+            }
+        }
+    }
+
+    float sampleRate = 44100.0;
+    AUAudioFrameCount dezipperRampDuration = 882;
+
+    std::unique_ptr<Instance[]> instances;
+    int instanceCapacity = 0;
+    // Control thread only.
+    std::vector<int> freeInstances;
+    std::vector<int> freeLanes; // descending, lowest lane at the back
+    SPSCRing<Command, 2 * kMaxInstances> commands; // control to render
+    SPSCRing<int, kMaxInstances> releasedInstances; // render to control
+
+    DSPArena arena;
+    std::vector<Pack> packs;
+    int packCount = 0;
+    LaneWindow attackWindow;
+    LaneWindow releaseWindow;
+    size_t delayFrames = 0;
+    size_t delayCapacity = 1;
+    size_t delayWriteIndex = 0;
+
+    // Per-lane parameters of the pack being rendered.
+    float laneInputGain[kLanes];
+    float laneAttackAmount[kLanes];
+    float laneReleaseAmount[kLanes];
+    float laneOutputAmount[kLanes];
+    float laneAttackSlides[kSegments][kLanes];
+    float laneReleaseSlides[kSegments][kLanes];
+
+    // Interleaved scratch buffers for the pack being rendered.
+    double squaresBlock[kBlockFrames * kLanes];
+    float gainedBlock[kBlockFrames * kLanes];
+    float attackRMSBlock[kBlockFrames * kLanes];
+    float releaseRMSBlock[kBlockFrames * kLanes];
+    float attackEnvBlock[kBlockFrames * kLanes];
+    float releaseEnvBlock[kBlockFrames * kLanes];
+    float gainBlock[kBlockFrames * kLanes];
+};
+#endif /* IntensifierBatchKernel_h */
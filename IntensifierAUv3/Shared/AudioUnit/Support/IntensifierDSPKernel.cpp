@@ -0,0 +1,13 @@
+#include "IntensifierDSPKernel.hpp"
+
+// Out-of-line definitions for the constants, needed when they are odr-used before C++17.
+constexpr int IntensifierDSPKernel::kMaxChannels;
+constexpr int IntensifierDSPKernel::kBlockFrames;
+constexpr int IntensifierDSPKernel::kDefaultControlRateFrames;
+constexpr int IntensifierDSPKernel::kMaxDetectorDecimation;
+constexpr int IntensifierDSPKernel::kMeterRate;
+constexpr int IntensifierDSPKernel::kParameterCount;
+constexpr unsigned int IntensifierDSPKernel::kAttackRMSPoints;
+constexpr unsigned int IntensifierDSPKernel::kReleaseRMSPoints;
+constexpr double IntensifierDSPKernel::kLookaheadMs;
+constexpr float IntensifierDSPKernel::kSettledLevel;
@@ -1,10 +1,15 @@
 #ifndef IntensifierDSPKernel_h
 #define IntensifierDSPKernel_h
-#import "DSPKernel.hpp"
-#import "ParameterRamper.hpp"
-#import "AdjustableDelayLine.h"
-#import "rmsaverage.h"
-#import "slide.h"
+#include "DSPKernel.hpp"
+#include "ParameterRamper.hpp"
+#include "DecibelGain.hpp"
+#include "DSPArena.hpp"
+#include "DenormalGuard.hpp"
+#include "LookaheadDelay.hpp"
+#include "RecursiveRMS.hpp"
+#include "SPSCRing.hpp"
+#include "rmsaverage.h"
+#include "slide.h"
 static inline float convertBadValuesToZero(float x)
 {
     /*
@@ -39,32 +44,131 @@ static inline double squared(double x) {
  IntensifierDSPKernel
  Performs our filter signal processing.
  As a non-ObjC class, this is safe to use from render thread.
+
+ The render path is compiled once per supported channel count and detector
+ link, see RenderFeature, and init() picks the matching one, so the hot
+ loops run over a constant channel count with no configuration checks.
  */
-class IntensifierDSPKernel : public DSPKernel
+class IntensifierDSPKernel : public DSPKernel<IntensifierDSPKernel>
 {
 public:
+    // Largest bus supported: 7.1.
+    static constexpr int kMaxChannels = 8;
+    // Longest sub-block rendered by one pass of the pipeline.
+    static constexpr int kBlockFrames = 128;
+    static constexpr int kDefaultControlRateFrames = 16;
+    // Largest detector decimation factor, see setDetectorDecimation().
+    static constexpr int kMaxDetectorDecimation = 32;
+    // Meter readings published per second while metering is enabled.
+    static constexpr int kMeterRate = 60;
+    // Parameters, in IntensifierParam address order.
+    static constexpr int kParameterCount = 6;
+    // Detector windows, in samples at full rate, and the lookahead.
+    static constexpr unsigned int kAttackRMSPoints = 441;
+    static constexpr unsigned int kReleaseRMSPoints = 882;
+    static constexpr double kLookaheadMs = 10.0;
+
+    /*
+     Features compiled into a render path or its detectors. Only those that
+     change the inner loops are compiled in; metering and decimation are
+     chosen per sub-block.
+     */
+    enum RenderFeature : unsigned {
+        kRecursiveDetectorsFeature = 1u << 0,
+        // Linked detectors, one bit per key, see DetectorLink; at most one is set.
+        kMaxLinkedDetectorsFeature = 1u << 1,
+        kAverageLinkedDetectorsFeature = 1u << 2,
+        kMidLinkedDetectorsFeature = 1u << 3,
+        kLinkedDetectorsFeatures = kMaxLinkedDetectorsFeature | kAverageLinkedDetectorsFeature | kMidLinkedDetectorsFeature
+    };
+
+    // How the channels share the detectors, see setDetectorLink().
+    enum DetectorLink : int {
+        kDetectorLinkOff = 0, // one detector per channel
+        kDetectorLinkMax,     // keyed by the loudest channel
+        kDetectorLinkAverage, // keyed by the power averaged over the channels
+        kDetectorLinkMid      // keyed by the mid, the channels' mean
+    };
+
+    // One metering interval, over all channels.
+    struct MeterReading {
+        float inputPeak; // before the input gain
+        float inputRMS;
+        float outputPeak;
+        float outputRMS;
+        float attackEnvelope; // highest detector envelope, in RMS units
+        float releaseEnvelope;
+        float gainDecibels; // mean gain applied
+    };
+
+    /*
+     Per-channel slide state, stored structure-of-arrays so the channel loop
+     of each slide stage maps one SIMD lane to one channel.
+     */
     struct IntensifierState {
-        float inputdB = 0.0;
-        float attackdB = 0.0;
-        float releasedB = 0.0;
-        float outputdB = 0.0;
+        float attackSlideUp[kMaxChannels];
+        float attackSlideDown[kMaxChannels];
+        float releaseSlideDown[kMaxChannels];
+
+        // Decimated detectors: squares summed over the current group, and the envelope ramps.
+        float groupSquares[kMaxChannels];
+        float attackEnvFrom[kMaxChannels];
+        float attackEnvTo[kMaxChannels];
+        float releaseEnvFrom[kMaxChannels];
+        float releaseEnvTo[kMaxChannels];
+
+        // Recursive detectors: the mean squares, see setRecursiveDetectors().
+        float attackMeanSquare[kMaxChannels];
+        float releaseMeanSquare[kMaxChannels];
 
         void clear() {
-            inputdB = 0.0;
-            attackdB = 0.0;
-            releasedB = 0.0;
-            outputdB = 0.0;
+            std::fill(attackSlideUp, attackSlideUp + kMaxChannels, 0.0f);
+            std::fill(attackSlideDown, attackSlideDown + kMaxChannels, 0.0f);
+            std::fill(releaseSlideDown, releaseSlideDown + kMaxChannels, 0.0f);
+            std::fill(groupSquares, groupSquares + kMaxChannels, 0.0f);
+            std::fill(attackEnvFrom, attackEnvFrom + kMaxChannels, 0.0f);
+            std::fill(attackEnvTo, attackEnvTo + kMaxChannels, 0.0f);
+            std::fill(releaseEnvFrom, releaseEnvFrom + kMaxChannels, 0.0f);
+            std::fill(releaseEnvTo, releaseEnvTo + kMaxChannels, 0.0f);
+            std::fill(attackMeanSquare, attackMeanSquare + kMaxChannels, 0.0f);
+            std::fill(releaseMeanSquare, releaseMeanSquare + kMaxChannels, 0.0f);
         }
 
-        void convertBadStateValuesToZero() {
+        void convertBadStateValuesToZero(int channelCount) {
             /*
-             Make sure the dB levels never get bad values
+             Make sure the envelopes never get bad values
              such as infinity or NaN
              */
-            inputdB = convertBadValuesToZero(inputdB);
-            attackdB = convertBadValuesToZero(attackdB);
-            releasedB = convertBadValuesToZero(releasedB);
-            outputdB = convertBadValuesToZero(outputdB);
+            for (int channel = 0; channel < channelCount; ++channel) {
+                attackSlideUp[channel] = convertBadValuesToZero(attackSlideUp[channel]);
+                attackSlideDown[channel] = convertBadValuesToZero(attackSlideDown[channel]);
+                releaseSlideDown[channel] = convertBadValuesToZero(releaseSlideDown[channel]);
+                groupSquares[channel] = convertBadValuesToZero(groupSquares[channel]);
+                attackEnvFrom[channel] = convertBadValuesToZero(attackEnvFrom[channel]);
+                attackEnvTo[channel] = convertBadValuesToZero(attackEnvTo[channel]);
+                releaseEnvFrom[channel] = convertBadValuesToZero(releaseEnvFrom[channel]);
+                releaseEnvTo[channel] = convertBadValuesToZero(releaseEnvTo[channel]);
+                attackMeanSquare[channel] = convertBadValuesToZero(attackMeanSquare[channel]);
+                releaseMeanSquare[channel] = convertBadValuesToZero(releaseMeanSquare[channel]);
+            }
+        }
+
+        // True if every envelope state is below level.
+        bool isSettled(int channelCount, float level) const {
+            float peak = 0.0f;
+            for (int channel = 0; channel < channelCount; ++channel) {
+                peak = std::max(peak, fabsf(attackSlideUp[channel]));
+                peak = std::max(peak, fabsf(attackSlideDown[channel]));
+                peak = std::max(peak, fabsf(releaseSlideDown[channel]));
+                peak = std::max(peak, fabsf(groupSquares[channel]));
+                peak = std::max(peak, fabsf(attackEnvFrom[channel]));
+                peak = std::max(peak, fabsf(attackEnvTo[channel]));
+                peak = std::max(peak, fabsf(releaseEnvFrom[channel]));
+                peak = std::max(peak, fabsf(releaseEnvTo[channel]));
+                peak = std::max(peak, sqrtf(fabsf(attackMeanSquare[channel])));
+                peak = std::max(peak, sqrtf(fabsf(releaseMeanSquare[channel])));
+            }
+            return peak < level;
         }
     };
 
@@ -74,34 +178,31 @@ public:
     releaseAmountRamper(0.0),
     attackTimeRamper(20.0),
     releaseTimeRamper(1.0),
-    outputAmountRamper(0.0) {}
+    outputAmountRamper(0.0) {
+        // process() applies host parameter events at their frames, see expandScheduledParameters().
+        setSchedulesParameterEvents(true);
+    }
 
     void init(int channelCount, double inSampleRate)
     {
-        channelStates.resize(channelCount);
+        channels = std::min(channelCount, int(kMaxChannels));
 
         sampleRate = float(inSampleRate);
         nyquist = 0.5 * sampleRate;
         inverseNyquist = 1.0 / nyquist;
         dezipperRampDuration = (AUAudioFrameCount)floor(0.02 * sampleRate);
+        meterIntervalFrames = std::max(1, int(lround(sampleRate / kMeterRate)));
+#if INTENSIFIER_RENDER_STATS
+        renderStats.setSampleRate(sampleRate);
+#endif
         inputAmountRamper.init();
         attackAmountRamper.init();
         releaseAmountRamper.init();
         attackTimeRamper.init();
         releaseTimeRamper.init();
         outputAmountRamper.init();
-        RMSAverage1->clear();
-        RMSAverage1->init(sampleRate, 441);
-        RMSAverage2->clear();
-        RMSAverage2->init(sampleRate, 882);
-        attackSlideUp->clear();
-        attackSlideUp->init(882, 0);
-        attackSlideDown->clear();
-        attackSlideDown->init(0, 882);
-        releaseSlideDown->clear();
-        releaseSlideDown->init(0, 44100);
-        delay1->clear();
-        delay1->init(sampleRate, 10);
+        initDetectors();
+        selectRenderPath();
     }
     void deinit()
     {
@@ -114,21 +215,141 @@ public:
         attackTimeRamper.reset();
         releaseTimeRamper.reset();
         outputAmountRamper.reset();
-        for (IntensifierState& state : channelStates) {
-            state.clear();
-        }
-        RMSAverage1->clear();
-        RMSAverage1->init(sampleRate, 441);
-        RMSAverage2->clear();
-        RMSAverage2->init(sampleRate, 882);
-        attackSlideUp->clear();
-        attackSlideUp->init(882, 0);
-        attackSlideDown->clear();
-        attackSlideDown->init(0, 882);
-        releaseSlideDown->clear();
-        releaseSlideDown->init(0, 44100);
-        delay1->clear();
-        delay1->init(sampleRate, 10);
+        clearDetectors();
+    }
+    /*
+     How often, in frames, the attack and release times are re-evaluated
+     while they ramp. 1 evaluates them every frame.
+     */
+    void setControlRateFrames(int frames) {
+        controlRateFrames = clamp(frames, 1, int(kBlockFrames));
+    }
+    int getControlRateFrames() const {
+        return controlRateFrames;
+    }
+    /*
+     Runs the RMS detectors, slides and comparators once every factor
+     frames instead of every frame, and ramps the envelopes linearly back
+     up to audio rate. factor is rounded down to a power of two up to
+     kMaxDetectorDecimation; 1 is the full-rate detector. Set it before
+     init(), which sizes the detector windows for it.
+
+     Each RMS detector sees the RMS of every group of factor frames, over a
+     window of the nearest whole number of groups, and the slides take
+     factor times fewer, factor times larger steps. The envelopes trail the
+     full-rate ones by one group, so the lookahead delay grows by one group
+     to keep them aligned with the audio (the latency grows with it).
+
+     This is an approximation, and not a close one at high sample rates.
+     A full-rate slide snaps to its input whenever the input moves too
+     little per sample for a 1/length step to register (see slide::step),
+     so a long release slide tracks a slowly falling RMS; decimated steps
+     see factor times the change and keep sliding, which leaves a larger
+     release envelope. Long slides snap more at high rates, so that is where
+     the modes differ most. The 99th percentile of the gain difference, in
+     dB, over factors 2 to 32 (intensifier-bench --deviation):
+
+                 44.1 kHz    48 kHz     96 kHz      192 kHz
+       Subtle    0.30-0.53   0.54-0.70  2.09-2.22   2.29-3.12
+       W I D E   0.07-0.83   0.07-0.65  0.56-0.93   2.53-2.55
+       CrOnchy   6.30-6.53   6.17-6.52  12.1-12.4   20.1-27.0
+
+     The medians stay under 2 dB. It is off by default and the audio unit
+     does not use it; only the offline tools offer it, for renders that can
+     trade this accuracy for speed.
+     */
+    void setDetectorDecimation(int factor) {
+        factor = clamp(factor, 1, int(kMaxDetectorDecimation));
+        detectorDecimation = 1;
+        while (detectorDecimation * 2 <= factor) {
+            detectorDecimation *= 2;
+        }
+    }
+    int getDetectorDecimation() const {
+        return detectorDecimation;
+    }
+    /*
+     Replaces the RMS detectors' moving windows with RecursiveRMS one-pole
+     averages of kAttackRMSPoints and kReleaseRMSPoints points, which keep
+     one float per detector instead of a window of doubles per channel, and
+     skip the window's read and write per sample. Works with detector
+     decimation. Set it before init(), which lays the detectors out for it.
+
+     This is not equivalent to the windows and changes the sound. The
+     averages decay exponentially instead of dropping to zero once a sound
+     has left the window. The slides snap to an input that moves too little
+     per sample for their step to register (see slide::step), so on a smooth
+     decay the release slide tracks the RMS instead of being left behind by
+     the drop, and the release envelope stays small. The 99th percentile of
+     the gain difference from the windows, in dB, at full rate
+     (intensifier-bench --deviation --recursive-detectors):
+
+                 44.1 kHz   48 kHz   96 kHz   192 kHz
+       Subtle    4.9        4.6      2.6      1.9
+       W I D E   13.1       12.7     12.2     7.2
+       CrOnchy   6.0        25.6     31.9     16.0
+
+     The medians stay under 1.5 dB, except W I D E at 192 kHz (4.9 dB). It
+     is off by default and the audio unit does not use it; only the offline
+     tools offer it.
+     */
+    void setRecursiveDetectors(bool recursive) {
+        recursiveDetectors = recursive;
+    }
+    bool getRecursiveDetectors() const {
+        return recursiveDetectors;
+    }
+    /*
+     Links the channels: one set of RMS detectors, slides and comparators
+     runs on a key signal mixed from all channels, and its gain applies to
+     every channel, so the image holds still while the gain moves. The key
+     is, per frame, the largest magnitude of the channels (max), the square
+     root of their mean square (average), or their mean (mid; for stereo
+     (L + R) / 2, which out-of-phase side content does not reach). Mono
+     kernels ignore it. Set it before init(), which picks the render path.
+
+     The detectors then cost the same for any channel count, and the gain
+     is computed and converted to amplitude once per frame.
+     */
+    void setDetectorLink(DetectorLink link) {
+        detectorLink = link;
+    }
+    DetectorLink getDetectorLink() const {
+        return detectorLink;
+    }
+    /*
+     Whether process() flushes subnormals to zero while it runs, see
+     DenormalGuard. On by default; turning it off is only useful to measure
+     what it saves.
+     */
+    void setFlushDenormals(bool shouldFlush) {
+        flushDenormals = shouldFlush;
+    }
+    /*
+     Metering: while enabled, process() publishes a MeterReading about every
+     1/kMeterRate seconds (whole sub-blocks at a time) to a wait-free ring
+     that another thread drains with popMeterReading(). Readings are dropped while nobody drains them.
+     Disabled, it costs one relaxed atomic load per process() call.
+     */
+    void setMeteringEnabled(bool enabled) {
+        meteringEnabled.store(enabled, std::memory_order_relaxed);
+    }
+    bool popMeterReading(MeterReading& reading) {
+        return meterReadings.pop(reading);
+    }
+    // Seconds of output after the input goes silent: the lookahead delay.
+    double tailTime() const {
+        return double(lookaheadFrames()) / sampleRate;
+    }
+    /*
+     True if every process() call since the last call to this one rendered
+     silence without running the DSP, see process(). Bypassed calls are never
+     silent here. Re-arms for the next render cycle.
+     */
+    bool takeOutputIsSilence() {
+        bool silent = outputIsSilence;
+        outputIsSilence = true;
+        return silent;
     }
     bool isBypassed() {
         return bypassed;
@@ -136,26 +357,26 @@ public:
     void setBypass(bool shouldBypass) {
         bypassed = shouldBypass;
     }
-    void setParameter(AUParameterAddress address, AUValue value) {
+    // Clamps value to the range of the parameter at address.
+    static AUValue clampParameter(AUParameterAddress address, AUValue value) {
         switch (address) {
             case IntensifierParamInputAmount:
-                inputAmountRamper.setUIValue(clamp(value, -40.0f, 15.0f));
-                break;
+            case IntensifierParamOutputAmount:
+                return clamp(value, -40.0f, 15.0f);
             case IntensifierParamAttackAmount:
-                attackAmountRamper.setUIValue(clamp(value, -40.0f, 30.0f));
-                break;
             case IntensifierParamReleaseAmount:
-                releaseAmountRamper.setUIValue(clamp(value, -40.0f, 30.0f));
-                break;
+                return clamp(value, -40.0f, 30.0f);
             case IntensifierParamAttackTime:
-                attackTimeRamper.setUIValue(clamp(value, 0.0f, 500.0f));
-                break;
+                return clamp(value, 0.0f, 500.0f);
             case IntensifierParamReleaseTime:
-                releaseTimeRamper.setUIValue(clamp(value, 0.0f, 5.0f));
-                break;
-            case IntensifierParamOutputAmount:
-                outputAmountRamper.setUIValue(clamp(value, -40.0f, 15.0f));
-                break;
+                return clamp(value, 0.0f, 5.0f);
+            default:
+                return value;
+        }
+    }
+    void setParameter(AUParameterAddress address, AUValue value) {
+        if (address < AUParameterAddress(kParameterCount)) {
+            rampers[address]->setUIValue(clampParameter(address, value));
         }
     }
     AUValue getParameter(AUParameterAddress address)
@@ -179,139 +400,178 @@ public:
             default: return 0.0;
         }
     }
-    void startRamp(AUParameterAddress address, AUValue value, AUAudioFrameCount duration) override
+    void startRamp(AUParameterAddress address, AUValue value, AUAudioFrameCount duration)
     {
-        switch (address) {
-            case IntensifierParamInputAmount:
-                inputAmountRamper.startRamp(clamp(value, -40.0f, 15.0f), duration);
-                break;
-            case IntensifierParamAttackAmount:
-                attackAmountRamper.startRamp(clamp(value, -40.0f, 30.0f), duration);
-                break;
-            case IntensifierParamReleaseAmount:
-                releaseAmountRamper.startRamp(clamp(value, -40.0f, 30.0f), duration);
-                break;
-            case IntensifierParamAttackTime:
-                attackTimeRamper.startRamp(clamp(value, 0.0f, 500.0f), duration);
-                break;
-            case IntensifierParamReleaseTime:
-                releaseTimeRamper.startRamp(clamp(value, 0.0f, 5.0f), duration);
-                break;
-            case IntensifierParamOutputAmount:
-                outputAmountRamper.startRamp(clamp(value, -40.0f, 15.0f), duration);
-                break;
+        if (address < AUParameterAddress(kParameterCount)) {
+            rampers[address]->startRamp(clampParameter(address, value), duration);
         }
     }
-    void setBuffers(AudioBufferList* inBufferList, AudioBufferList* outBufferList)
+    /*
+     Planar buffers, one per channel, read and written at the bufferOffset
+     passed to process(). Input and output may be the same buffers.
+     */
+    void setBuffers(const float* const* inBuffers, float* const* outBuffers)
     {
-        inBufferListPtr = inBufferList;
-        outBufferListPtr = outBufferList;
+        for (int channel = 0; channel < channels; ++channel) {
+            inBufferPtrs[channel] = inBuffers[channel];
+            outBufferPtrs[channel] = outBuffers[channel];
+        }
     }
-    void process(AUAudioFrameCount frameCount, AUAudioFrameCount bufferOffset) override
+    void process(AUAudioFrameCount frameCount, AUAudioFrameCount bufferOffset)
     {
-        float inputSample;
         if (bypassed) {
-            // Pass the samples through
-            int channelCount = int(channelStates.size());
+            // Pass the samples through. They are not known to be silent; the adapter passes on the input's silence flag.
+            outputIsSilence = false;
+            int channelCount = channels;
             for (int channel = 0; channel < channelCount; ++channel) {
-                if (inBufferListPtr->mBuffers[channel].mData ==  outBufferListPtr->mBuffers[channel].mData) {
+                if (inBufferPtrs[channel] == outBufferPtrs[channel]) {
                     continue;
                 }
-                for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                for (AUAudioFrameCount frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
                     int frameOffset = int(frameIndex + bufferOffset);
-                    float* in  = (float*)inBufferListPtr->mBuffers[channel].mData  + frameOffset;
-                    float* out = (float*)outBufferListPtr->mBuffers[channel].mData + frameOffset;
+                    const float* in  = inBufferPtrs[channel]  + frameOffset;
+                    float* out = outBufferPtrs[channel] + frameOffset;
                     *out = *in;
                 }
             }
             return;
         }
 
-        int channelCount = int(channelStates.size());
-
-        inputAmountRamper.dezipperCheck(dezipperRampDuration);
-        attackAmountRamper.dezipperCheck(dezipperRampDuration);
-        releaseAmountRamper.dezipperCheck(dezipperRampDuration);
-        attackTimeRamper.dezipperCheck(dezipperRampDuration);
-        releaseTimeRamper.dezipperCheck(dezipperRampDuration);
-        outputAmountRamper.dezipperCheck(dezipperRampDuration);
-
-        delay1->setDelayMs(20.0);
-        delay1->setFeedback(0.0);
-        float *tmpAttackOut;
-        float tmpAttackOutVal;
-        tmpAttackOut = &tmpAttackOutVal;
-
-        float *tmpReleaseOut;
-        float tmpReleaseOutVal;
-        tmpReleaseOut = &tmpReleaseOutVal;
-        float *tmpMixOut;
-        float tmpMixOutVal;
-        tmpMixOut = &tmpMixOutVal;
-        // For each sample.
-        for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
-            int frameOffset = int(frameIndex + bufferOffset);
-            /*
-             The parameter values are updated every sample! This is very
-             expensive. You probably want to do things differently.
-             */
+        bool metering = meteringEnabled.load(std::memory_order_relaxed);
+        if (metering != meteringActive) {
+            meteringActive = metering;
+            meter = MeterAccumulator();
+        }
+        (this->*renderPath)(frameCount, bufferOffset);
+    }
+private:
+    typedef void (IntensifierDSPKernel::*RenderPath)(AUAudioFrameCount frameCount, AUAudioFrameCount bufferOffset);
 
-            float inputAmount = (float)inputAmountRamper.get();
-            float outputAmount = (float)outputAmountRamper.get();
-            float attackA = (float)attackAmountRamper.get() * 2.5;
-            float releaseA = (float)releaseAmountRamper.get() * 2.5;
-            float attackT = (float)attackTimeRamper.get();
-            float releaseT = (float)releaseTimeRamper.get();
-            releaseT = releaseT * 1000;
-            attackT = convertMsToSamples(attackT, sampleRate);
-            releaseT = convertMsToSamples(releaseT, sampleRate);
-            attackSlideUp->setslideup(attackT);
-            attackSlideDown->setslidedown(attackT);
-            releaseSlideDown->setslidedown(releaseT);
-
-            // advance sample
-            for (int channel = 0; channel < channelCount; ++channel) {
-                const float *in = (const float*)inBufferListPtr->mBuffers[channel].mData  + frameOffset;
-                inputSample = *in;
-                float *out = (float*)outBufferListPtr->mBuffers[channel].mData + frameOffset;
-                // convert decibels to amplitude
-                *out = (inputSample * pow(10., inputAmount / 20.0));
-                compute_attackLR(out, tmpAttackOut, RMSAverage1, attackSlideUp, attackSlideDown);
-                compute_releaseLR(out, tmpReleaseOut, RMSAverage2, releaseSlideDown);
-                *tmpAttackOut = *tmpAttackOut * attackA;
-                *tmpReleaseOut = *tmpReleaseOut * releaseA;
-                // mix release and attack
-                *tmpMixOut = *tmpAttackOut + *tmpReleaseOut;
-                // convert decibels to amplitude
-                *tmpMixOut = pow(10., *tmpMixOut / 20.0);
-                // reduce/increase output decibels
-                *tmpMixOut = *tmpMixOut * pow(10., outputAmount / 20.0);
-                delay1->push(*out);
-                *out = delay1->getOutput() * *tmpMixOut;
-            }
-            inputAmountRamper.step();
-            attackAmountRamper.step();
-            releaseAmountRamper.step();
-            attackTimeRamper.step();
-            releaseTimeRamper.step();
-            outputAmountRamper.step();
+    // The channel count of a render path: Channels, or the configured count for the generic path (0).
+    template <int Channels>
+    int channelCountFor() const {
+        return Channels > 0 ? Channels : channels;
+    }
+    /*
+     Picks the render path for the configured channel count and detector
+     link. The channel counts the audio unit
+     supports (see channelCapabilities) have their own paths; others, which
+     only the offline tools use, take the generic one.
+     */
+    void selectRenderPath()
+    {
+        switch (channels) {
+            case 1: selectRenderPath<1>(); break;
+            case 2: selectRenderPath<2>(); break;
+            case 6: selectRenderPath<6>(); break;
+            case 8: selectRenderPath<8>(); break;
+            default: selectRenderPath<0>(); break;
+        }
+    }
+    template <int Channels>
+    void selectRenderPath()
+    {
+        // Mono paths have nothing to link.
+        switch (linkedDetectors() ? detectorLink : kDetectorLinkOff) {
+            case kDetectorLinkMax:
+                renderPath = &IntensifierDSPKernel::render<Channels, Channels == 1 ? 0u : kMaxLinkedDetectorsFeature>;
+                break;
+            case kDetectorLinkAverage:
+                renderPath = &IntensifierDSPKernel::render<Channels, Channels == 1 ? 0u : kAverageLinkedDetectorsFeature>;
+                break;
+            case kDetectorLinkMid:
+                renderPath = &IntensifierDSPKernel::render<Channels, Channels == 1 ? 0u : kMidLinkedDetectorsFeature>;
+                break;
+            default:
+                renderPath = &IntensifierDSPKernel::render<Channels, 0>;
+                break;
         }
+    }
+    bool linkedDetectors() const {
+        return detectorLink != kDetectorLinkOff && channels > 1;
+    }
+    // Channels with detectors of their own: one while they are linked.
+    int detectorChannels() const {
+        return linkedDetectors() ? 1 : channels;
+    }
+
+    template <int Channels, unsigned Features>
+    void render(AUAudioFrameCount frameCount, AUAudioFrameCount bufferOffset)
+    {
+        const int channelCount = channelCountFor<Channels>();
+        DenormalGuard denormalGuard(flushDenormals);
+
+        parametersRamping = ParameterRamper::dezipperCheck(rampers, kParameterCount, dezipperRampDuration);
+        // Scheduled host events may start ramps anywhere in the cycle.
+        parametersRamping |= parameterSchedule.nextFrame(bufferOffset + frameCount) < bufferOffset + frameCount;
+
+        /*
+         Once the input has been digitally silent for long enough that the
+         RMS windows and the lookahead delay hold only zeros, and the slides
+         have decayed below kSettledLevel, the output is silent too and the
+         DSP is skipped until the input comes back.
+         */
+        bool inputSilent = isInputSilent(frameCount, bufferOffset, channelCount);
+        if (inputSilent && detectorsSettled) {
+            renderSilence(frameCount, bufferOffset, channelCount);
+            return;
+        }
+        detectorsSettled = false;
+        outputIsSilence = false;
+
+        /*
+         Render in sub-blocks of at most kBlockFrames. Each stage of the
+         pipeline runs over the whole sub-block before the next one starts,
+         so the stateless stages become simple loops over contiguous scratch
+         buffers that the compiler can vectorize.
+         */
+        AUAudioFrameCount framesRemaining = frameCount;
+        while (framesRemaining > 0) {
+            int blockFrames = int(std::min(framesRemaining, AUAudioFrameCount(kBlockFrames)));
+            processBlock<Channels, Features>(blockFrames, bufferOffset + frameCount - framesRemaining);
+            framesRemaining -= blockFrames;
+        }
+
         // Squelch any blowups once per cycle.
-        for (int channel = 0; channel < channelCount; ++channel) {
-            channelStates[channel].convertBadStateValuesToZero();
+        channelStates.convertBadStateValuesToZero(channelCount);
+
+        silentFrames = inputSilent ? std::min(silentFrames + frameCount, settleFrames) : 0;
+        if (silentFrames == settleFrames && channelStates.isSettled(channelCount, kSettledLevel)) {
+            // Snap the slides' last few steps to zero, where the next sound starts from anyway.
+            channelStates.clear();
+            detectorsSettled = true;
         }
     }
-private:
-    std::vector<IntensifierState> channelStates;
+
+    IntensifierState channelStates;
+    int channels = 0;
     float sampleRate = 44100.0;
     float nyquist = 0.5 * sampleRate;
     float inverseNyquist = 1.0 / nyquist;
     AUAudioFrameCount dezipperRampDuration;
 
-    AudioBufferList* inBufferListPtr = nullptr;
-    AudioBufferList* outBufferListPtr = nullptr;
+    const float* inBufferPtrs[kMaxChannels] = {};
+    float* outBufferPtrs[kMaxChannels] = {};
 
     bool bypassed = false;
+    bool flushDenormals = true;
+
+    // Metering, see setMeteringEnabled().
+    struct MeterAccumulator {
+        float inputPeak = 0.0f;
+        float inputSquares = 0.0f;
+        float outputPeak = 0.0f;
+        float outputSquares = 0.0f;
+        float attackEnvelope = 0.0f;
+        float releaseEnvelope = 0.0f;
+        float gainDecibels = 0.0f;
+        int frames = 0;
+    };
+    std::atomic<bool> meteringEnabled{false};
+    bool meteringActive = false;
+    int meterIntervalFrames = 735;
+    MeterAccumulator meter;
+    SPSCRing<MeterReading, 64> meterReadings;
 
 public:
 
@@ -323,12 +583,303 @@ public:
     ParameterRamper releaseTimeRamper;
     ParameterRamper outputAmountRamper;
 private:
-    CycloneObjects::rmsaverage* RMSAverage1 = new CycloneObjects::rmsaverage();
-    CycloneObjects::rmsaverage* RMSAverage2 = new CycloneObjects::rmsaverage();
-    CycloneObjects::slide* attackSlideUp = new CycloneObjects::slide();
-    CycloneObjects::slide* attackSlideDown = new CycloneObjects::slide();;
-    CycloneObjects::slide* releaseSlideDown = new CycloneObjects::slide();;
-    DunneCore::AdjustableDelayLine* delay1 = new DunneCore::AdjustableDelayLine();
+    ParameterRamper* const rampers[kParameterCount] = {
+        &inputAmountRamper,
+        &attackAmountRamper,
+        &releaseAmountRamper,
+        &attackTimeRamper,
+        &releaseTimeRamper,
+        &outputAmountRamper
+    };
+    bool parametersRamping = false;
+    // See selectRenderPath().
+    RenderPath renderPath = &IntensifierDSPKernel::render<0, 0>;
+
+    // Per-channel detectors and lookahead delays, with their sample memory in arena.
+    /*
+     Envelope level (about -120 dBFS) below which silent detectors count as
+     settled. Dropping it changes the gain by well under 0.001 dB.
+     */
+    static constexpr float kSettledLevel = 1e-6f;
+    DSPArena arena;
+    CycloneObjects::rmsaverage attackRMS[kMaxChannels];
+    CycloneObjects::rmsaverage releaseRMS[kMaxChannels];
+    LookaheadDelay delays[kMaxChannels];
+
+    /*
+     Attack and release times are evaluated at control rate: a sub-block is
+     split into segments with constant slide lengths.
+     */
+    struct SlideSegment {
+        int endFrame;
+        float attackSlide;
+        float releaseSlide;
+    };
+    SlideSegment slideSegments[kBlockFrames];
+    int controlRateFrames = kDefaultControlRateFrames;
+    int detectorDecimation = 1;
+    bool recursiveDetectors = false;
+    DetectorLink detectorLink = kDetectorLinkOff;
+    // RecursiveRMS coefficients for the window lengths at the configured decimation.
+    float attackRMSCoefficient = 1.0f;
+    float releaseRMSCoefficient = 1.0f;
+    // Frames summed into the current decimated detector group.
+    int groupFrames = 0;
+
+    // Silence skipping, see process().
+    AUAudioFrameCount settleFrames = 0;
+    AUAudioFrameCount silentFrames = 0;
+    bool detectorsSettled = true;
+    bool outputIsSilence = true;
+    float attackTimeValue = -1.0;
+    float releaseTimeValue = -1.0;
+    float attackSlideSamples = 0.0;
+    float releaseSlideSamples = 0.0;
+
+    // Scratch buffers for the block-staged pipeline.
+    float keyBlock[1][kBlockFrames]; // linked detectors' input, see setDetectorLink()
+    float inputAmountBlock[kBlockFrames];
+    float outputAmountBlock[kBlockFrames];
+    float inputGainBlock[kBlockFrames];
+    float attackAmountBlock[kBlockFrames];
+    float releaseAmountBlock[kBlockFrames];
+    float gainedBlock[kMaxChannels][kBlockFrames];
+    float rmsBlock[kBlockFrames];
+    float attackRMSBlock[kBlockFrames * kMaxChannels];
+    float releaseRMSBlock[kBlockFrames * kMaxChannels];
+    float attackEnvBlock[kBlockFrames * kMaxChannels];
+    float releaseEnvBlock[kBlockFrames * kMaxChannels];
+    float gainBlock[kBlockFrames * kMaxChannels];
+
+    // Longest lookahead: kLookaheadMs plus the decimated detectors' extra group.
+    /*
+     kLookaheadMs, rounded to whole samples. The decimated detectors'
+     envelopes trail by one group, so the audio is delayed by one more group
+     to keep the gain lined up with it.
+     */
+    size_t lookaheadFrames() const
+    {
+        size_t frames = size_t(lround(kLookaheadMs * sampleRate / 1000.0));
+        return detectorDecimation > 1 ? frames + detectorDecimation : frames;
+    }
+    /*
+     Bytes of detector and delay memory for the configured channels, sample
+     rate and detector mode: a lookahead delay per channel, and RMS windows
+     per detector channel unless the detectors are recursive.
+     */
+    size_t detectorArenaBytes() const
+    {
+        size_t windowBytes = DSPArena::bytesFor<double>(CycloneObjects::rmsaverage::storageSize(kAttackRMSPoints))
+                             + DSPArena::bytesFor<double>(CycloneObjects::rmsaverage::storageSize(kReleaseRMSPoints));
+        size_t windowChannels = recursiveDetectors ? 0 : size_t(detectorChannels());
+        return windowChannels * windowBytes
+               + size_t(channels) * DSPArena::bytesFor<float>(LookaheadDelay::storageSize(lookaheadFrames(), kBlockFrames));
+    }
+    /*
+     Lays the detectors out in the arena, channel by channel. init() runs
+     outside the render thread, so the arena grows there when a new
+     configuration needs more than an earlier one; it never shrinks, so
+     going back to a smaller one reuses it. Recursive detectors have no
+     windows to lay out.
+     */
+    void initDetectors()
+    {
+        arena.reserve(detectorArenaBytes());
+        arena.rewind();
+        // Decimated detectors see one value per group, over a window of the nearest whole number of groups.
+        unsigned int attackPoints = (kAttackRMSPoints + detectorDecimation / 2) / detectorDecimation;
+        unsigned int releasePoints = (kReleaseRMSPoints + detectorDecimation / 2) / detectorDecimation;
+        attackRMSCoefficient = RecursiveRMS::coefficientFor(attackPoints);
+        releaseRMSCoefficient = RecursiveRMS::coefficientFor(releasePoints);
+        for (int channel = 0; channel < channels; ++channel) {
+            if (recursiveDetectors || channel >= detectorChannels()) {
+                // Drop any windows of an earlier init(), which point into memory the delays now use.
+                attackRMS[channel].deinit();
+                releaseRMS[channel].deinit();
+            } else {
+                attackRMS[channel].init(sampleRate, attackPoints, arena.take<double>(CycloneObjects::rmsaverage::storageSize(kAttackRMSPoints)));
+                releaseRMS[channel].init(sampleRate, releasePoints, arena.take<double>(CycloneObjects::rmsaverage::storageSize(kReleaseRMSPoints)));
+            }
+            delays[channel].init(lookaheadFrames(), kBlockFrames, arena.take<float>(LookaheadDelay::storageSize(lookaheadFrames(), kBlockFrames)));
+            delays[channel].setDelayFrames(lookaheadFrames());
+        }
+        // Silent input clears the longest RMS window and the delay in this many frames.
+        settleFrames = AUAudioFrameCount(std::max(size_t(releasePoints * detectorDecimation), lookaheadFrames()) + detectorDecimation);
+        clearDetectors();
+    }
+    // Zeroes all detector state in place; allocation-free.
+    void clearDetectors()
+    {
+        // Force the slide lengths to be recomputed.
+        attackTimeValue = -1.0;
+        releaseTimeValue = -1.0;
+        channelStates.clear();
+        groupFrames = 0;
+        silentFrames = settleFrames;
+        detectorsSettled = true;
+        for (int channel = 0; channel < channels; ++channel) {
+            attackRMS[channel].clear();
+            releaseRMS[channel].clear();
+            delays[channel].clear();
+        }
+    }
+
+    bool isInputSilent(AUAudioFrameCount frameCount, AUAudioFrameCount bufferOffset, int channelCount) const
+    {
+        // Or together the bits of every sample but the signs, so that only zeros (of either sign) pass.
+        uint32_t bits = 0;
+        for (int channel = 0; channel < channelCount; ++channel) {
+            const float *in = inBufferPtrs[channel] + bufferOffset;
+            for (AUAudioFrameCount frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                uint32_t sampleBits;
+                memcpy(&sampleBits, in + frameIndex, sizeof(sampleBits));
+                bits |= sampleBits;
+            }
+        }
+        return (bits & 0x7fffffffu) == 0;
+    }
+    /*
+     Writes silence and advances everything that moves with time alone: the
+     parameter ramps and the decimated detectors' group phase. The RMS
+     windows and the delay hold only zeros, so they need not move.
+     */
+    void renderSilence(AUAudioFrameCount frameCount, AUAudioFrameCount bufferOffset, int channelCount)
+    {
+        for (int channel = 0; channel < channelCount; ++channel) {
+            float *out = outBufferPtrs[channel] + bufferOffset;
+            if (out != inBufferPtrs[channel] + bufferOffset) {
+                std::fill(out, out + frameCount, 0.0f);
+            }
+        }
+        if (parametersRamping) {
+            skipParameters(frameCount, bufferOffset);
+        }
+        groupFrames = int((groupFrames + frameCount) % AUAudioFrameCount(detectorDecimation));
+        if (meteringActive) {
+            // Silent in and out, settled envelopes: only the output gain applies.
+            meter.gainDecibels += outputAmountRamper.get() * float(frameCount * channelCount);
+            finishMeterBlock(int(frameCount), channelCount);
+        }
+    }
+
+    // Peak and sum of squares of one channel of a block.
+    static void accumulateLevels(const float *samples, int frameCount, float& peak, float& squares)
+    {
+        float blockPeak = peak;
+        float blockSquares = 0.0f;
+        for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+            blockPeak = std::max(blockPeak, fabsf(samples[frameIndex]));
+            blockSquares += samples[frameIndex] * samples[frameIndex];
+        }
+        peak = blockPeak;
+        squares += blockSquares;
+    }
+    // Publishes a reading once a whole interval has been accumulated.
+    void finishMeterBlock(int frameCount, int channelCount)
+    {
+        meter.frames += frameCount;
+        if (meter.frames < meterIntervalFrames) {
+            return;
+        }
+        float inverseSamples = 1.0f / float(meter.frames * channelCount);
+        MeterReading reading = {
+            meter.inputPeak,
+            sqrtf(meter.inputSquares * inverseSamples),
+            meter.outputPeak,
+            sqrtf(meter.outputSquares * inverseSamples),
+            meter.attackEnvelope,
+            meter.releaseEnvelope,
+            meter.gainDecibels * inverseSamples
+        };
+        meterReadings.push(reading);
+        meter = MeterAccumulator();
+    }
+
+    void setSlideTimes(float attackTime, float releaseTime)
+    {
+        attackTimeValue = attackTime;
+        releaseTimeValue = releaseTime;
+        attackSlideSamples = CycloneObjects::slide::samples(convertMsToSamples(attackTime, sampleRate));
+        releaseSlideSamples = CycloneObjects::slide::samples(convertMsToSamples(releaseTime * 1000, sampleRate));
+    }
+
+    /*
+     Splits frameCount frames of a sub-block, from firstFrame on, into slide
+     segments appended after the first segmentCount, and returns the new
+     count. While neither time parameter ramps the frames are one segment,
+     and the slide lengths are only recomputed when a time parameter has
+     jumped to a new value. During a ramp they are re-evaluated every
+     controlRateFrames frames.
+     */
+    int updateSlideSegments(int firstFrame, int frameCount, int segmentCount)
+    {
+        int endFrame = firstFrame + frameCount;
+        if (!attackTimeRamper.isRamping() && !releaseTimeRamper.isRamping()) {
+            float attackTime = attackTimeRamper.get();
+            float releaseTime = releaseTimeRamper.get();
+            if (attackTime != attackTimeValue || releaseTime != releaseTimeValue) {
+                setSlideTimes(attackTime, releaseTime);
+            }
+            slideSegments[segmentCount++] = { endFrame, attackSlideSamples, releaseSlideSamples };
+            return segmentCount;
+        }
+
+        for (int startFrame = firstFrame; startFrame < endFrame; startFrame += controlRateFrames) {
+            int segmentFrames = std::min(controlRateFrames, endFrame - startFrame);
+            setSlideTimes(attackTimeRamper.get(), releaseTimeRamper.get());
+            attackTimeRamper.stepBy(segmentFrames);
+            releaseTimeRamper.stepBy(segmentFrames);
+            slideSegments[segmentCount++] = { startFrame + segmentFrames, attackSlideSamples, releaseSlideSamples };
+        }
+        return segmentCount;
+    }
+
+    // A ramper's next frameCount values, per frame whether it ramps or not.
+    static void expandRamp(ParameterRamper& ramper, float *buffer, int frameCount)
+    {
+        if (!ramper.getAndStepBlock(buffer, frameCount)) {
+            std::fill(buffer, buffer + frameCount, ramper.get());
+        }
+    }
+    /*
+     Parameters for a sub-block that scheduled host events fall in. The
+     sub-block is cut at the events' frames; each piece is expanded from the
+     rampers as they stand, with slide segments starting afresh, and the
+     events are applied between pieces. The values are those of a cycle
+     split at the events, without rendering the pieces separately. Every
+     gain parameter comes out per frame; returns the slide segment count.
+     */
+    int expandScheduledParameters(int frameCount, AUAudioFrameCount bufferOffset)
+    {
+        AUAudioFrameCount endFrame = bufferOffset + AUAudioFrameCount(frameCount);
+        int segmentCount = 0;
+        for (AUAudioFrameCount frame = bufferOffset; frame < endFrame;) {
+            applyScheduledEvents(frame);
+            AUAudioFrameCount pieceEnd = parameterSchedule.nextFrame(endFrame);
+            int firstFrame = int(frame - bufferOffset);
+            int pieceFrames = int(pieceEnd - frame);
+            expandRamp(inputAmountRamper, inputAmountBlock + firstFrame, pieceFrames);
+            expandRamp(attackAmountRamper, attackAmountBlock + firstFrame, pieceFrames);
+            expandRamp(releaseAmountRamper, releaseAmountBlock + firstFrame, pieceFrames);
+            expandRamp(outputAmountRamper, outputAmountBlock + firstFrame, pieceFrames);
+            segmentCount = updateSlideSegments(firstFrame, pieceFrames, segmentCount);
+            frame = pieceEnd;
+        }
+        return segmentCount;
+    }
+    // Steps the parameters over frames that are not rendered, applying scheduled events on the way.
+    void skipParameters(AUAudioFrameCount frameCount, AUAudioFrameCount bufferOffset)
+    {
+        AUAudioFrameCount endFrame = bufferOffset + frameCount;
+        for (AUAudioFrameCount frame = bufferOffset; frame < endFrame;) {
+            applyScheduledEvents(frame);
+            AUAudioFrameCount pieceEnd = parameterSchedule.nextFrame(endFrame);
+            for (ParameterRamper *ramper : rampers) {
+                ramper->stepBy(pieceEnd - frame);
+            }
+            frame = pieceEnd;
+        }
+    }
 
     float convertMsToSamples(float fMilleseconds, float fSampleRate)
     {
@@ -342,83 +893,377 @@ private:
     float convertSecondsToCutoffFrequency(float fSeconds) {
         return 1.0 / (2 * M_PI * fSeconds);
     }
-    int compute_attackLR(const float *inChannel,
-                         float *outChannel,
-                         CycloneObjects::rmsaverage *average,
-                         CycloneObjects::slide *slideUp,
-                         CycloneObjects::slide *slideDown)
+    /*
+     The linked detectors' key signal, mixed from the gained channels into
+     keyBlock, see setDetectorLink(). The key is the one in Features.
+     */
+    template <int Channels, unsigned Features>
+    void mixDetectorKey(int frameCount)
     {
-        average->push(*inChannel);
-        *outChannel = average->getOutput();
-        // Copy this signal for later comparison
-        float attackMixCopy = *outChannel;
-        slideUp->push(*outChannel);
-        *outChannel = slideUp->getOutput();
-        float slideMixCopy = *outChannel;
-        // MARK: BEGIN Logic
-        float slideToCompare = slideMixCopy + 0.0; // FIXME: later replace this with attack sensitivity
-        float comparator1 = 0.0;
-        if (attackMixCopy >= slideToCompare)
-            comparator1 = 1.0;
-        else
-            comparator1 = 0.0;
-        float subtractedMix1 = attackMixCopy - slideMixCopy;
-        *outChannel = comparator1 * subtractedMix1;
-        // MARK: END Logic
-        slideDown->push(*outChannel);
-        *outChannel = slideDown->getOutput();
-        return 1;
-    }
-
-    int compute_releaseLR(const float *inChannel,
-                         float *outChannel,
-                          CycloneObjects::rmsaverage *average,
-                          CycloneObjects::slide *slideDown)
+        const int channelCount = channelCountFor<Channels>();
+        float *key = keyBlock[0];
+        switch (Features & kLinkedDetectorsFeatures) {
+            case kMaxLinkedDetectorsFeature:
+                for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                    key[frameIndex] = fabsf(gainedBlock[0][frameIndex]);
+                }
+                for (int channel = 1; channel < channelCount; ++channel) {
+                    const float *gained = gainedBlock[channel];
+                    for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                        key[frameIndex] = std::max(key[frameIndex], fabsf(gained[frameIndex]));
+                    }
+                }
+                break;
+            case kAverageLinkedDetectorsFeature: {
+                float inverseChannels = 1.0f / float(channelCount);
+                std::fill(key, key + frameCount, 0.0f);
+                for (int channel = 0; channel < channelCount; ++channel) {
+                    const float *gained = gainedBlock[channel];
+                    for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                        key[frameIndex] += gained[frameIndex] * gained[frameIndex];
+                    }
+                }
+                for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                    key[frameIndex] = sqrtf(key[frameIndex] * inverseChannels);
+                }
+                break;
+            }
+            case kMidLinkedDetectorsFeature: {
+                float inverseChannels = 1.0f / float(channelCount);
+                std::fill(key, key + frameCount, 0.0f);
+                for (int channel = 0; channel < channelCount; ++channel) {
+                    const float *gained = gainedBlock[channel];
+                    for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                        key[frameIndex] += gained[frameIndex];
+                    }
+                }
+                for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                    key[frameIndex] *= inverseChannels;
+                }
+                break;
+            }
+        }
+    }
+    /*
+     Full-rate detectors: fill attackEnvBlock and releaseEnvBlock, interleaved,
+     from the Channels planar blocks of input: gainedBlock, or keyBlock for
+     linked detectors.
+     */
+    template <int Channels, unsigned Features>
+    void processDetectors(const float (*input)[kBlockFrames], int frameCount, int segmentCount)
     {
+        const int channelCount = channelCountFor<Channels>();
+        int sampleCount = frameCount * channelCount;
 
-        float *tmpRMSOut;
-        float tmpRMSOutVal;
-        tmpRMSOut = &tmpRMSOutVal;
-
-        average->push(*inChannel);
-        *outChannel = average->getOutput();
-
-        float *tmpMixOut;
-        float tmpMixOutVal;
-        tmpMixOut = &tmpMixOutVal;
+        if (Features & kRecursiveDetectorsFeature) {
+            // Recursive RMS detectors, which are recursive in time like the slides: one lane per channel.
+            float *attackMeanSquare = channelStates.attackMeanSquare;
+            float *releaseMeanSquare = channelStates.releaseMeanSquare;
+            for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                float *attack = attackRMSBlock + frameIndex * channelCount;
+                float *release = releaseRMSBlock + frameIndex * channelCount;
+                for (int channel = 0; channel < channelCount; ++channel) {
+                    float gained = input[channel][frameIndex];
+                    attackMeanSquare[channel] = RecursiveRMS::step(attackMeanSquare[channel], gained, attackRMSCoefficient);
+                    attack[channel] = attackMeanSquare[channel];
+                    releaseMeanSquare[channel] = RecursiveRMS::step(releaseMeanSquare[channel], gained, releaseRMSCoefficient);
+                    release[channel] = releaseMeanSquare[channel];
+                }
+            }
+            for (int sampleIndex = 0; sampleIndex < sampleCount; ++sampleIndex) {
+                attackRMSBlock[sampleIndex] = sqrtf(attackRMSBlock[sampleIndex]);
+                releaseRMSBlock[sampleIndex] = sqrtf(releaseRMSBlock[sampleIndex]);
+            }
+        } else {
+            // RMS detectors, a block per channel, interleaved for the slides.
+            for (int channel = 0; channel < channelCount; ++channel) {
+                const float *gained = input[channel];
+                attackRMS[channel].process(gained, rmsBlock, frameCount);
+                for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                    attackRMSBlock[frameIndex * channelCount + channel] = rmsBlock[frameIndex];
+                }
+                releaseRMS[channel].process(gained, rmsBlock, frameCount);
+                for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                    releaseRMSBlock[frameIndex * channelCount + channel] = rmsBlock[frameIndex];
+                }
+            }
+        }
 
-        // Mix Left and Right Channel (on left channel) and half them
-        *tmpMixOut = *tmpRMSOut * 0.5;
+        // Attack: slide up, keep only the part of the RMS above it, then slide down.
+        float *attackSlideUp = channelStates.attackSlideUp;
+        for (int segment = 0, frameIndex = 0; segment < segmentCount; ++segment) {
+            float slideSamples = slideSegments[segment].attackSlide;
+            for (; frameIndex < slideSegments[segment].endFrame; ++frameIndex) {
+                const float *rms = attackRMSBlock + frameIndex * channelCount;
+                float *env = attackEnvBlock + frameIndex * channelCount;
+                for (int channel = 0; channel < channelCount; ++channel) {
+                    attackSlideUp[channel] = CycloneObjects::slide::step(rms[channel], attackSlideUp[channel], slideSamples, 0.0f);
+                    env[channel] = attackSlideUp[channel];
+                }
+            }
+        }
+        for (int sampleIndex = 0; sampleIndex < sampleCount; ++sampleIndex) {
+            // FIXME: later add attack sensitivity to the slide before comparing
+            float rms = attackRMSBlock[sampleIndex];
+            float slide = attackEnvBlock[sampleIndex];
+            attackEnvBlock[sampleIndex] = float(rms >= slide) * (rms - slide);
+        }
+        float *attackSlideDown = channelStates.attackSlideDown;
+        for (int segment = 0, frameIndex = 0; segment < segmentCount; ++segment) {
+            float slideSamples = slideSegments[segment].attackSlide;
+            for (; frameIndex < slideSegments[segment].endFrame; ++frameIndex) {
+                float *env = attackEnvBlock + frameIndex * channelCount;
+                for (int channel = 0; channel < channelCount; ++channel) {
+                    attackSlideDown[channel] = CycloneObjects::slide::step(env[channel], attackSlideDown[channel], 0.0f, slideSamples);
+                    env[channel] = attackSlideDown[channel];
+                }
+            }
+        }
 
-        // Copy this signal for later comparison
-        float releaseMixCopy = *outChannel;
+        // Release: slide down, then keep only the part of the RMS below it.
+        float *releaseSlideDown = channelStates.releaseSlideDown;
+        for (int segment = 0, frameIndex = 0; segment < segmentCount; ++segment) {
+            float slideSamples = slideSegments[segment].releaseSlide;
+            for (; frameIndex < slideSegments[segment].endFrame; ++frameIndex) {
+                const float *rms = releaseRMSBlock + frameIndex * channelCount;
+                float *env = releaseEnvBlock + frameIndex * channelCount;
+                for (int channel = 0; channel < channelCount; ++channel) {
+                    releaseSlideDown[channel] = CycloneObjects::slide::step(rms[channel], releaseSlideDown[channel], 0.0f, slideSamples);
+                    env[channel] = releaseSlideDown[channel];
+                }
+            }
+        }
+        for (int sampleIndex = 0; sampleIndex < sampleCount; ++sampleIndex) {
+            // FIXME: later add release sensitivity to the slide before comparing
+            float rms = releaseRMSBlock[sampleIndex];
+            float slide = releaseEnvBlock[sampleIndex];
+            releaseEnvBlock[sampleIndex] = float(rms <= slide) * (slide - rms);
+        }
+    }
+    // One step of a decimated RMS detector: its window, or its mean square with recursive detectors.
+    template <unsigned Features>
+    static float detectorRMS(CycloneObjects::rmsaverage& window, float& meanSquare, float coefficient, float input)
+    {
+        if (Features & kRecursiveDetectorsFeature) {
+            meanSquare = RecursiveRMS::step(meanSquare, input, coefficient);
+            return sqrtf(meanSquare);
+        }
+        return window.push(input);
+    }
+    /*
+     Decimated detectors, see setDetectorDecimation(). Squares are summed
+     per group of detectorDecimation frames; when a group completes, its RMS
+     runs through the detectors and the envelopes ramp from their previous
+     values to the new ones over the next group. Groups carry across
+     sub-blocks, so the result does not depend on the host's buffer size.
+     Reads input like processDetectors().
+     */
+    template <int Channels, unsigned Features>
+    void processDecimatedDetectors(const float (*input)[kBlockFrames], int frameCount, int segmentCount)
+    {
+        const int channelCount = channelCountFor<Channels>();
+        float inverseDecimation = 1.0f / float(detectorDecimation);
+        float *groupSquares = channelStates.groupSquares;
+        float *attackEnvFrom = channelStates.attackEnvFrom;
+        float *attackEnvTo = channelStates.attackEnvTo;
+        float *releaseEnvFrom = channelStates.releaseEnvFrom;
+        float *releaseEnvTo = channelStates.releaseEnvTo;
+        for (int segment = 0, frameIndex = 0; segment < segmentCount; ++segment) {
+            float attackSlide = CycloneObjects::slide::samples(slideSegments[segment].attackSlide * inverseDecimation);
+            float releaseSlide = CycloneObjects::slide::samples(slideSegments[segment].releaseSlide * inverseDecimation);
+            for (; frameIndex < slideSegments[segment].endFrame; ++frameIndex) {
+                float ramp = float(groupFrames + 1) * inverseDecimation;
+                float *attackEnv = attackEnvBlock + frameIndex * channelCount;
+                float *releaseEnv = releaseEnvBlock + frameIndex * channelCount;
+                for (int channel = 0; channel < channelCount; ++channel) {
+                    float gained = input[channel][frameIndex];
+                    groupSquares[channel] += gained * gained;
+                    attackEnv[channel] = attackEnvFrom[channel] + (attackEnvTo[channel] - attackEnvFrom[channel]) * ramp;
+                    releaseEnv[channel] = releaseEnvFrom[channel] + (releaseEnvTo[channel] - releaseEnvFrom[channel]) * ramp;
+                }
+                if (++groupFrames < detectorDecimation) {
+                    continue;
+                }
 
-        float *tmpSlideOut;
-        float tmpSlideOutVal;
-        tmpSlideOut = &tmpSlideOutVal;
+                // The group is complete: one control-rate step of the detectors.
+                groupFrames = 0;
+                for (int channel = 0; channel < channelCount; ++channel) {
+                    float groupRMS = sqrtf(groupSquares[channel] * inverseDecimation);
+                    groupSquares[channel] = 0.0f;
 
-        slideDown->push(*outChannel);
-        *outChannel = slideDown->getOutput();
+                    // FIXME: later add attack sensitivity to the slide before comparing
+                    float rms = detectorRMS<Features>(attackRMS[channel], channelStates.attackMeanSquare[channel], attackRMSCoefficient, groupRMS);
+                    float slideUp = CycloneObjects::slide::step(rms, channelStates.attackSlideUp[channel], attackSlide, 0.0f);
+                    channelStates.attackSlideUp[channel] = slideUp;
+                    float attack = float(rms >= slideUp) * (rms - slideUp);
+                    channelStates.attackSlideDown[channel] = CycloneObjects::slide::step(attack, channelStates.attackSlideDown[channel], 0.0f, attackSlide);
+                    attackEnvFrom[channel] = attackEnvTo[channel];
+                    attackEnvTo[channel] = channelStates.attackSlideDown[channel];
 
-        float slideMixCopy = *outChannel;
+                    // FIXME: later add release sensitivity to the slide before comparing
+                    rms = detectorRMS<Features>(releaseRMS[channel], channelStates.releaseMeanSquare[channel], releaseRMSCoefficient, groupRMS);
+                    float slideDown = CycloneObjects::slide::step(rms, channelStates.releaseSlideDown[channel], 0.0f, releaseSlide);
+                    channelStates.releaseSlideDown[channel] = slideDown;
+                    releaseEnvFrom[channel] = releaseEnvTo[channel];
+                    releaseEnvTo[channel] = float(rms <= slideDown) * (slideDown - rms);
+                }
+            }
+        }
+    }
+    // The detectors for the configured RMS type and decimation.
+    template <int Channels>
+    void processDetectors(const float (*input)[kBlockFrames], int frameCount, int segmentCount)
+    {
+        if (detectorDecimation > 1) {
+            if (recursiveDetectors) {
+                processDecimatedDetectors<Channels, kRecursiveDetectorsFeature>(input, frameCount, segmentCount);
+            } else {
+                processDecimatedDetectors<Channels, 0>(input, frameCount, segmentCount);
+            }
+        } else if (recursiveDetectors) {
+            processDetectors<Channels, kRecursiveDetectorsFeature>(input, frameCount, segmentCount);
+        } else {
+            processDetectors<Channels, 0>(input, frameCount, segmentCount);
+        }
+    }
+    /*
+     Renders one sub-block of at most kBlockFrames frames, one stage at a time.
+     The gained input is kept planar for the RMS detectors and the delays. The
+     envelopes are kept interleaved (frame by frame, channel by channel) so the
+     slide stages, which are recursive in time, can run the channels of one
+     frame side by side, one lane per channel, and the stateless stages run
+     over one contiguous buffer.
+     */
+    template <int Channels, unsigned Features>
+    void processBlock(int frameCount, AUAudioFrameCount bufferOffset)
+    {
+        const int channelCount = channelCountFor<Channels>();
+        const bool metering = meteringActive;
+        const bool linked = (Features & kLinkedDetectorsFeatures) != 0;
+        // Envelopes and gains are interleaved over the detector channels: one while linked.
+        const int envelopeChannels = linked ? 1 : channelCount;
+        int envelopeCount = frameCount * envelopeChannels;
+        INTENSIFIER_STATS_START(renderStats);
 
-        // MARK: BEGIN Logic
+        /*
+         Parameter ramps. Only ramping parameters are expanded into per-frame
+         buffers; the others stay scalars and their stages take the
+         constant-parameter path. Sub-blocks with host events in them are
+         expanded piece by piece.
+         */
+        bool inputRamping, attackRamping, releaseRamping, outputRamping;
+        int segmentCount;
+        if (parameterSchedule.nextFrame(bufferOffset + frameCount) < bufferOffset + frameCount) {
+            segmentCount = expandScheduledParameters(frameCount, bufferOffset);
+            inputRamping = attackRamping = releaseRamping = outputRamping = true;
+        } else {
+            inputRamping = parametersRamping && inputAmountRamper.getAndStepBlock(inputAmountBlock, frameCount);
+            attackRamping = parametersRamping && attackAmountRamper.getAndStepBlock(attackAmountBlock, frameCount);
+            releaseRamping = parametersRamping && releaseAmountRamper.getAndStepBlock(releaseAmountBlock, frameCount);
+            outputRamping = parametersRamping && outputAmountRamper.getAndStepBlock(outputAmountBlock, frameCount);
+            segmentCount = updateSlideSegments(0, frameCount, 0);
+        }
 
-        float slideToCompare = slideMixCopy + 0.0; // FIXME: later replace this with release sensitivity
+        // Input gain.
+        if (inputRamping) {
+            DecibelGain::toAmplitude(inputAmountBlock, inputGainBlock, frameCount);
+            for (int channel = 0; channel < channelCount; ++channel) {
+                const float *in = inBufferPtrs[channel] + bufferOffset;
+                float *gained = gainedBlock[channel];
+                for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                    gained[frameIndex] = in[frameIndex] * inputGainBlock[frameIndex];
+                }
+            }
+        } else {
+            float inputGain = DecibelGain::toAmplitude(inputAmountRamper.get());
+            for (int channel = 0; channel < channelCount; ++channel) {
+                const float *in = inBufferPtrs[channel] + bufferOffset;
+                float *gained = gainedBlock[channel];
+                for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                    gained[frameIndex] = in[frameIndex] * inputGain;
+                }
+            }
+        }
 
-        float comparator1 = 0.0;
+        if (metering) {
+            for (int channel = 0; channel < channelCount; ++channel) {
+                accumulateLevels(inBufferPtrs[channel] + bufferOffset, frameCount, meter.inputPeak, meter.inputSquares);
+            }
+        }
+        INTENSIFIER_STATS_LAP(kInputGain);
 
-        if (releaseMixCopy <= slideToCompare)
-            comparator1 = 1.0;
-        else
-            comparator1 = 0.0;
+        /*
+         RMS detectors, slides and comparators, once for the key signal if
+         linked: the linked paths of every channel count share the mono
+         detectors.
+         */
+        if (linked) {
+            mixDetectorKey<Channels, Features>(frameCount);
+            processDetectors<1>(keyBlock, frameCount, segmentCount);
+        } else {
+            processDetectors<Channels>(gainedBlock, frameCount, segmentCount);
+        }
+        INTENSIFIER_STATS_LAP(kDetectors);
 
-        float subtractedMix1 = slideMixCopy - releaseMixCopy;
+        /*
+         Gain: mix attack and release, add the output gain in decibels and
+         convert the sum to amplitude in one pass.
+         */
+        if (attackRamping || releaseRamping || outputRamping) {
+            if (!attackRamping) {
+                std::fill(attackAmountBlock, attackAmountBlock + frameCount, attackAmountRamper.get());
+            }
+            if (!releaseRamping) {
+                std::fill(releaseAmountBlock, releaseAmountBlock + frameCount, releaseAmountRamper.get());
+            }
+            if (!outputRamping) {
+                std::fill(outputAmountBlock, outputAmountBlock + frameCount, outputAmountRamper.get());
+            }
+            for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                float attackAmount = attackAmountBlock[frameIndex] * 2.5;
+                float releaseAmount = releaseAmountBlock[frameIndex] * 2.5;
+                for (int channel = 0; channel < envelopeChannels; ++channel) {
+                    int sampleIndex = frameIndex * envelopeChannels + channel;
+                    gainBlock[sampleIndex] = attackEnvBlock[sampleIndex] * attackAmount + releaseEnvBlock[sampleIndex] * releaseAmount + outputAmountBlock[frameIndex];
+                }
+            }
+        } else {
+            float attackAmount = attackAmountRamper.get() * 2.5;
+            float releaseAmount = releaseAmountRamper.get() * 2.5;
+            float outputAmount = outputAmountRamper.get();
+            for (int sampleIndex = 0; sampleIndex < envelopeCount; ++sampleIndex) {
+                gainBlock[sampleIndex] = attackEnvBlock[sampleIndex] * attackAmount + releaseEnvBlock[sampleIndex] * releaseAmount + outputAmount;
+            }
+        }
+        if (metering) {
+            // A linked gain applies to every channel.
+            float gainWeight = float(channelCount / envelopeChannels);
+            for (int sampleIndex = 0; sampleIndex < envelopeCount; ++sampleIndex) {
+                meter.attackEnvelope = std::max(meter.attackEnvelope, attackEnvBlock[sampleIndex]);
+                meter.releaseEnvelope = std::max(meter.releaseEnvelope, releaseEnvBlock[sampleIndex]);
+                meter.gainDecibels += gainBlock[sampleIndex] * gainWeight;
+            }
+        }
+        DecibelGain::toAmplitude(gainBlock, gainBlock, envelopeCount);
+        INTENSIFIER_STATS_LAP(kGain);
 
-        *outChannel = comparator1 * subtractedMix1;
+        // Lookahead delay straight into the output, then apply the gain there.
+        for (int channel = 0; channel < channelCount; ++channel) {
+            float *out = outBufferPtrs[channel] + bufferOffset;
+            delays[channel].process(gainedBlock[channel], out, frameCount);
+            const float *gain = gainBlock + (linked ? 0 : channel);
+            for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+                out[frameIndex] *= gain[frameIndex * envelopeChannels];
+            }
+        }
+        INTENSIFIER_STATS_LAP(kDelay);
 
-        // MARK: END Logic
-        return 1;
+        if (metering) {
+            for (int channel = 0; channel < channelCount; ++channel) {
+                accumulateLevels(outBufferPtrs[channel] + bufferOffset, frameCount, meter.outputPeak, meter.outputSquares);
+            }
+            finishMeterBlock(frameCount, channelCount);
+        }
     }
 };
 #endif /* IntensifierDSPKernel_h */
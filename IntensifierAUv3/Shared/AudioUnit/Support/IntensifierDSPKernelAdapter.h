@@ -1,15 +1,50 @@
 #import <AudioToolbox/AudioToolbox.h>
 @class AUv3IntensifierViewController;
 NS_ASSUME_NONNULL_BEGIN
+
+// Levels over one metering interval, see IntensifierDSPKernel::MeterReading.
+typedef struct IntensifierMeterReading {
+    float inputPeak;
+    float inputRMS;
+    float outputPeak;
+    float outputRMS;
+    float attackEnvelope;
+    float releaseEnvelope;
+    float gainDecibels;
+} IntensifierMeterReading;
+
 @interface IntensifierDSPKernelAdapter : NSObject
 
+/*
+ Frames the input bus is sized for. Render cycles may be longer: when the
+ caller passes output buffers that hold them, their input is pulled into
+ those buffers and rendered in place; otherwise they are pulled and
+ rendered in pieces of this many frames, into the output bus's own
+ buffers if the caller passes none.
+ */
 @property (nonatomic) AUAudioFrameCount maximumFramesToRender;
 @property (nonatomic, readonly) AUAudioUnitBus *inputBus;
 @property (nonatomic, readonly) AUAudioUnitBus *outputBus;
+@property (nonatomic, readonly) NSTimeInterval tailTime;
+// Turn on while a meter is visible; metering costs nothing while it is off.
+@property (nonatomic) BOOL meteringEnabled;
 
 - (void)setParameter:(AUParameter *)parameter value:(AUValue)value;
 - (AUValue)valueForParameter:(AUParameter *)parameter;
 
+/*
+ Drains the readings published since the last call. Returns NO if there
+ were none; otherwise fills reading with the newest one, with its peaks
+ raised to the highest of all drained readings.
+ */
+- (BOOL)readMeter:(IntensifierMeterReading *)reading;
+
+/*
+ Render timing counters (see RenderStats.hpp), or nil unless the audio unit
+ was built with INTENSIFIER_RENDER_STATS=1. Safe to call while rendering.
+ */
+- (nullable NSDictionary<NSString *, NSNumber *> *)renderStatistics;
+
 - (void)allocateRenderResources;
 - (void)deallocateRenderResources;
 - (AUInternalRenderBlock)internalRenderBlock;
@@ -3,10 +3,94 @@
 #import "BufferedAudioBus.hpp"
 #import "IntensifierDSPKernelAdapter.h"
 
+// Frames of the audio unit's own output buffers, for long cycles whose caller passes null output buffers.
+static const AUAudioFrameCount kOwnedOutputFrames = 16384;
+
+/*
+ Renders a cycle longer than maximumFramesToRender whose output buffers
+ cannot take its input in one pull (see canPullInputInto()): null ones,
+ or ones whose byte sizes are short of the cycle. Pieces of at most
+ maximumFramesToRender frames each pull their input into the input bus's
+ own buffer and are rendered from there into their part of the output,
+ with the events that fall in them. Null output buffers are pointed at
+ the output bus's own, which hold kOwnedOutputFrames frames; only a
+ longer cycle with null output buffers fails.
+ */
+static AUAudioUnitStatus renderInPieces(IntensifierDSPKernel *state,
+                                        BufferedInputBus *input,
+                                        BufferedOutputBus *output,
+                                        AudioUnitRenderActionFlags *actionFlags,
+                                        const AudioTimeStamp *timestamp,
+                                        AVAudioFrameCount frameCount,
+                                        AudioBufferList *outAudioBufferList,
+                                        const AURenderEvent *events,
+                                        AURenderPullInputBlock pullInputBlock) {
+    AUAudioFrameCount maxFrames = state->maximumFramesToRender();
+    if (maxFrames == 0) {
+        return kAudioUnitErr_TooManyFramesToProcess;
+    }
+    for (UInt32 i = 0; i < outAudioBufferList->mNumberBuffers; ++i) {
+        if (outAudioBufferList->mBuffers[i].mData == nullptr && frameCount > output->maxFrames) {
+            return kAudioUnitErr_TooManyFramesToProcess;
+        }
+    }
+    output->prepareOutputBufferList(outAudioBufferList, frameCount, false);
+    INTENSIFIER_STATS_CALLBACK(state->getRenderStats(), frameCount);
+
+    AudioTimeStamp pieceTimestamp = *timestamp;
+    const AURenderEvent *pieceEvents = events;
+    bool inputIsSilence = true;
+    for (AUAudioFrameCount framesDone = 0; framesDone < frameCount;) {
+        INTENSIFIER_STATS_START(state->getRenderStats());
+        AUAudioFrameCount pieceFrames = std::min(frameCount - framesDone, maxFrames);
+
+        AudioUnitRenderActionFlags pullFlags = 0;
+        AUAudioUnitStatus err = input->pullInput(&pullFlags, &pieceTimestamp, pieceFrames, 0, pullInputBlock);
+        INTENSIFIER_STATS_LAP(kPullInput);
+
+        if (err != 0) { return err; }
+        inputIsSilence = inputIsSilence && (pullFlags & kAudioUnitRenderAction_OutputIsSilence) != 0;
+
+        AudioBufferList *inAudioBufferList = input->mutableAudioBufferList;
+        const float *inBuffers[IntensifierDSPKernel::kMaxChannels];
+        float *outBuffers[IntensifierDSPKernel::kMaxChannels];
+        UInt32 bufferCount = std::min(outAudioBufferList->mNumberBuffers, UInt32(IntensifierDSPKernel::kMaxChannels));
+        for (UInt32 i = 0; i < bufferCount; ++i) {
+            inBuffers[i] = (const float *)inAudioBufferList->mBuffers[i].mData;
+            outBuffers[i] = (float *)outAudioBufferList->mBuffers[i].mData + framesDone;
+        }
+
+        // The events before the end of the piece; the last piece takes the rest.
+        const AURenderEvent *pieceEventsEnd = nullptr;
+        if (framesDone + pieceFrames < frameCount) {
+            AUEventSampleTime pieceEnd = AUEventSampleTime(pieceTimestamp.mSampleTime) + AUEventSampleTime(pieceFrames);
+            pieceEventsEnd = pieceEvents;
+            while (pieceEventsEnd != nullptr && pieceEventsEnd->head.eventSampleTime < pieceEnd) {
+                pieceEventsEnd = pieceEventsEnd->head.next;
+            }
+        }
+
+        state->setBuffers(inBuffers, outBuffers);
+        state->processWithEvents(&pieceTimestamp, pieceFrames, pieceEvents, nil /* MIDIOutEventBlock */, pieceEventsEnd);
+
+        framesDone += pieceFrames;
+        pieceEvents = pieceEventsEnd;
+        // Later pieces start at a sample time the caller gave no host time for.
+        pieceTimestamp.mSampleTime += pieceFrames;
+        pieceTimestamp.mFlags &= kAudioTimeStampSampleTimeValid | kAudioTimeStampRateScalarValid;
+    }
+
+    if (state->takeOutputIsSilence() || (state->isBypassed() && inputIsSilence)) {
+        *actionFlags |= kAudioUnitRenderAction_OutputIsSilence;
+    }
+    return noErr;
+}
+
 @implementation IntensifierDSPKernelAdapter {
     // C++ members need to be ivars; they would be copied on access if they were properties.
     IntensifierDSPKernel  _kernel;
     BufferedInputBus _inputBus;
+    BufferedOutputBus _outputBusBuffer;
 }
 
 - (instancetype)init {
@@ -23,8 +107,9 @@
         _kernel.setParameter(IntensifierParamOutputAmount, 0);
 
         // Create the input and output busses.
-        _inputBus.init(format, 2);
-        _outputBus = [[AUAudioUnitBus alloc] initWithFormat:format error:nil];
+        _inputBus.init(format, IntensifierDSPKernel::kMaxChannels);
+        _outputBusBuffer.init(format, IntensifierDSPKernel::kMaxChannels);
+        _outputBus = _outputBusBuffer.bus;
     }
     return self;
 }
@@ -47,6 +132,60 @@
     _kernel.setMaximumFramesToRender(maximumFramesToRender);
 }
 
+- (NSTimeInterval)tailTime {
+    return _kernel.tailTime();
+}
+
+- (void)setMeteringEnabled:(BOOL)meteringEnabled {
+    _meteringEnabled = meteringEnabled;
+    _kernel.setMeteringEnabled(meteringEnabled);
+}
+
+- (nullable NSDictionary<NSString *, NSNumber *> *)renderStatistics {
+#if INTENSIFIER_RENDER_STATS
+    RenderStats::Snapshot stats = _kernel.getRenderStats().snapshot();
+    NSMutableDictionary<NSString *, NSNumber *> *result = [NSMutableDictionary dictionary];
+    result[@"callbacks"] = @(stats.callbacks);
+    result[@"frames"] = @(stats.frames);
+    result[@"deadline_misses"] = @(stats.deadlineMisses);
+    result[@"callback_ns"] = @(stats.callbackNanos);
+    result[@"deadline_ns"] = @(stats.deadlineNanos);
+    result[@"max_callback_ns"] = @(stats.maxCallbackNanos);
+    for (int stage = 0; stage < RenderStats::kStageCount; ++stage) {
+        result[[NSString stringWithFormat:@"%s_ns", RenderStats::stageName(stage)]] = @(stats.stageNanos[stage]);
+    }
+    for (int bucket = 0; bucket < RenderStats::kHistogramBuckets; ++bucket) {
+        result[[NSString stringWithFormat:@"load_bucket_%d", bucket]] = @(stats.histogram[bucket]);
+    }
+    return result;
+#else
+    return nil;
+#endif
+}
+
+- (BOOL)readMeter:(IntensifierMeterReading *)reading {
+    IntensifierDSPKernel::MeterReading next;
+    if (!_kernel.popMeterReading(next)) {
+        return NO;
+    }
+    IntensifierDSPKernel::MeterReading latest = next;
+    while (_kernel.popMeterReading(next)) {
+        next.inputPeak = std::max(next.inputPeak, latest.inputPeak);
+        next.outputPeak = std::max(next.outputPeak, latest.outputPeak);
+        next.attackEnvelope = std::max(next.attackEnvelope, latest.attackEnvelope);
+        next.releaseEnvelope = std::max(next.releaseEnvelope, latest.releaseEnvelope);
+        latest = next;
+    }
+    reading->inputPeak = latest.inputPeak;
+    reading->inputRMS = latest.inputRMS;
+    reading->outputPeak = latest.outputPeak;
+    reading->outputRMS = latest.outputRMS;
+    reading->attackEnvelope = latest.attackEnvelope;
+    reading->releaseEnvelope = latest.releaseEnvelope;
+    reading->gainDecibels = latest.gainDecibels;
+    return YES;
+}
+
 - (BOOL)shouldBypassEffect {
     return _kernel.isBypassed();
 }
@@ -57,12 +196,15 @@
 
 - (void)allocateRenderResources {
     _inputBus.allocateRenderResources(self.maximumFramesToRender);
+    _outputBusBuffer.allocateRenderResources(std::max(self.maximumFramesToRender, kOwnedOutputFrames));
+    // Also picks the kernel's render path compiled for this channel count.
     _kernel.init(self.outputBus.format.channelCount, self.outputBus.format.sampleRate);
     _kernel.reset();
 }
 
 - (void)deallocateRenderResources {
     _inputBus.deallocateRenderResources();
+    _outputBusBuffer.deallocateRenderResources();
     _kernel.deinit();
 }
 
@@ -77,6 +219,7 @@
     // Specify captured objects are mutable.
     __block IntensifierDSPKernel *state = &_kernel;
     __block BufferedInputBus *input = &_inputBus;
+    __block BufferedOutputBus *output = &_outputBusBuffer;
 
     return ^AUAudioUnitStatus(AudioUnitRenderActionFlags *actionFlags,
                               const AudioTimeStamp       *timestamp,
@@ -86,18 +229,6 @@
                               const AURenderEvent        *realtimeEventListHead,
                               AURenderPullInputBlock      pullInputBlock) {
 
-        AudioUnitRenderActionFlags pullFlags = 0;
-
-        if (frameCount > state->maximumFramesToRender()) {
-            return kAudioUnitErr_TooManyFramesToProcess;
-        }
-
-        AUAudioUnitStatus err = input->pullInput(&pullFlags, timestamp, frameCount, 0, pullInputBlock);
-
-        if (err != 0) { return err; }
-
-        AudioBufferList *inAudioBufferList = input->mutableAudioBufferList;
-
         /*
          Important:
          If the caller passed non-null output pointers (outputData->mBuffers[x].mData), use those.
@@ -112,18 +243,59 @@
 
          See the description of the canProcessInPlace property.
          */
+        AudioBufferList *outAudioBufferList = outputData;
+        AudioUnitRenderActionFlags pullFlags = 0;
+
+        /*
+         Cycles longer than maximumFramesToRender, which the input bus is
+         sized for, pull their input once, straight into the caller's output
+         buffers, and are rendered there in place in one pass, with all
+         their events. When those buffers cannot take the whole cycle they
+         are rendered in pieces instead, see renderInPieces().
+         */
+        bool longCycle = frameCount > state->maximumFramesToRender();
+        if (longCycle && !input->canPullInputInto(outAudioBufferList, frameCount)) {
+            return renderInPieces(state, input, output, actionFlags, timestamp, frameCount, outAudioBufferList, realtimeEventListHead, pullInputBlock);
+        }
+        INTENSIFIER_STATS_CALLBACK(state->getRenderStats(), frameCount);
+        INTENSIFIER_STATS_START(state->getRenderStats());
+
+        AUAudioUnitStatus err = longCycle
+            ? input->pullInputInto(outAudioBufferList, &pullFlags, timestamp, frameCount, 0, pullInputBlock)
+            : input->pullInput(&pullFlags, timestamp, frameCount, 0, pullInputBlock);
+        INTENSIFIER_STATS_LAP(kPullInput);
+
+        if (err != 0) { return err; }
+
+        AudioBufferList *inAudioBufferList = input->mutableAudioBufferList;
 
         // If passed null output buffer pointers, process in-place in the input buffer.
-        AudioBufferList *outAudioBufferList = outputData;
         if (outAudioBufferList->mBuffers[0].mData == nullptr) {
             for (UInt32 i = 0; i < outAudioBufferList->mNumberBuffers; ++i) {
                 outAudioBufferList->mBuffers[i].mData = inAudioBufferList->mBuffers[i].mData;
             }
         }
 
-        state->setBuffers(inAudioBufferList, outAudioBufferList);
+        const float *inBuffers[IntensifierDSPKernel::kMaxChannels];
+        float *outBuffers[IntensifierDSPKernel::kMaxChannels];
+        UInt32 bufferCount = std::min(outAudioBufferList->mNumberBuffers, UInt32(IntensifierDSPKernel::kMaxChannels));
+        for (UInt32 i = 0; i < bufferCount; ++i) {
+            inBuffers[i] = (const float *)inAudioBufferList->mBuffers[i].mData;
+            outBuffers[i] = (float *)outAudioBufferList->mBuffers[i].mData;
+        }
+
+        state->setBuffers(inBuffers, outBuffers);
         state->processWithEvents(timestamp, frameCount, realtimeEventListHead, nil /* MIDIOutEventBlock */);
 
+        /*
+         Let downstream units skip their work too while the kernel is skipping
+         silence, or while it passes through input that was flagged silent.
+         */
+        bool inputIsSilence = (pullFlags & kAudioUnitRenderAction_OutputIsSilence) != 0;
+        if (state->takeOutputIsSilence() || (state->isBypassed() && inputIsSilence)) {
+            *actionFlags |= kAudioUnitRenderAction_OutputIsSilence;
+        }
+
         return noErr;
     };
 }
@@ -0,0 +1,31 @@
+#ifndef IntensifierPresets_h
+#define IntensifierPresets_h
+#include "IntensifierDSPKernel.hpp"
+
+// Parameter identifiers, indexed by parameter address, as in AUv3IntensifierParameters.
+static const char* const IntensifierParameterIdentifiers[] = {
+    "inputAmount",
+    "attackAmount",
+    "releaseAmount",
+    "attackTime",
+    "releaseTime",
+    "outputAmount"
+};
+
+struct IntensifierPreset {
+    const char* name;
+    // Indexed by parameter address.
+    AUValue values[6];
+};
+
+/*
+ Factory presets for hosts without the AU, such as the offline tools.
+ Keep in sync with AUv3Intensifier.factoryPresets and factoryPresetValues.
+ */
+static const IntensifierPreset IntensifierFactoryPresets[] = {
+    { "Subtle", { 0.0, -29.0, 5.0, 149.0, 1.0, 0.0 } },
+    { "W I D E", { 15.0, -17.68, 1.59, 158.36, 0.31, 2.03 } },
+    { "CrOnchy", { 2.86, 5.68, -32.48, 272.9, 0.82, -9.02 } }
+};
+static const int IntensifierFactoryPresetCount = 3;
+#endif /* IntensifierPresets_h */
@@ -0,0 +1,86 @@
+#ifndef LookaheadDelay_h
+#define LookaheadDelay_h
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+
+/*
+ LookaheadDelay
+ Fixed whole-sample delay without feedback, for the lookahead path. The
+ ring buffer is a power of two long so the indices wrap with a mask, and
+ whole blocks go in and out with at most two memcpys each.
+ For modulated or fractional delays use DunneCore::AdjustableDelayLine.
+ */
+class LookaheadDelay {
+public:
+    /*
+     Floats of storage needed for delays up to maxDelayFrames with blocks of
+     up to maxBlockFrames: the next power of two that holds both, so a block
+     can be written before it is read without overwriting unread samples.
+     */
+    static size_t storageSize(size_t maxDelayFrames, size_t maxBlockFrames) {
+        size_t size = 1;
+        while (size < maxDelayFrames + maxBlockFrames) {
+            size *= 2;
+        }
+        return size;
+    }
+
+    // storage must hold storageSize(maxDelayFrames, maxBlockFrames) floats and outlive the delay.
+    void init(size_t maxDelayFrames, size_t maxBlockFrames, float* storage) {
+        buffer = storage;
+        capacity = storage != nullptr ? storageSize(maxDelayFrames, maxBlockFrames) : 0;
+        maxDelay = maxDelayFrames;
+        maxBlock = maxBlockFrames;
+        delay = 0;
+        clear();
+    }
+
+    void clear() {
+        if (buffer != nullptr) {
+            std::fill(buffer, buffer + capacity, 0.0f);
+        }
+        writeIndex = 0;
+    }
+
+    void setDelayFrames(size_t frames) { delay = std::min(frames, maxDelay); }
+    size_t getDelayFrames() const { return delay; }
+
+    /*
+     Delays count frames of in into out; count must not exceed the
+     maxBlockFrames given to init(). in and out may be the same buffer: the
+     block is written to the ring before the delayed block is read back.
+     */
+    void process(const float* in, float* out, int count) {
+        if (buffer == nullptr || count > int(maxBlock)) {
+            if (in != out) {
+                memmove(out, in, count * sizeof(float));
+            }
+            return;
+        }
+        size_t mask = capacity - 1;
+        copyIn(in, writeIndex, count);
+        copyOut(out, (writeIndex - delay) & mask, count);
+        writeIndex = (writeIndex + count) & mask;
+    }
+
+private:
+    void copyIn(const float* in, size_t index, size_t count) {
+        size_t first = std::min(count, capacity - index);
+        memcpy(buffer + index, in, first * sizeof(float));
+        memcpy(buffer, in + first, (count - first) * sizeof(float));
+    }
+    void copyOut(float* out, size_t index, size_t count) {
+        size_t first = std::min(count, capacity - index);
+        memcpy(out, buffer + index, first * sizeof(float));
+        memcpy(out + first, buffer, (count - first) * sizeof(float));
+    }
+
+    float* buffer = nullptr;
+    size_t capacity = 0; // power of two, or 0 when there is no storage
+    size_t maxDelay = 0;
+    size_t maxBlock = 0;
+    size_t delay = 0;
+    size_t writeIndex = 0;
+};
+#endif /* LookaheadDelay_h */
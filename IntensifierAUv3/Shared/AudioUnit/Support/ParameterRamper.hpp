@@ -1,8 +1,8 @@
 #ifndef ParameterRamper_h
 #define ParameterRamper_h
-#import <AudioToolbox/AudioToolbox.h>
-#import <libkern/OSAtomic.h>
-#import <atomic>
+#include "DSPTypes.hpp"
+#include <algorithm>
+#include <atomic>
 
 class ParameterRamper {
     float clampLow, clampHigh;
@@ -86,6 +86,10 @@ public:
             --samplesRemaining;
         }
     }
+    bool isRamping() const
+    {
+        return samplesRemaining != 0;
+    }
     float getAndStep()
     {
         // Combines get and step. Saves a multiply-add when not ramping.
@@ -98,6 +102,39 @@ public:
             return _goal;
         }
     }
+    bool getAndStepBlock(float *buffer, AUAudioFrameCount frameCount)
+    {
+        /*
+         Block version of getAndStep(). While a ramp is active, writes the next
+         frameCount values to buffer, advances the ramp and returns true. When
+         no ramp is active, returns false right away without touching buffer;
+         the value for the whole block is then get().
+         */
+        if (samplesRemaining == 0) {
+            return false;
+        }
+        AUAudioFrameCount rampFrames = std::min(frameCount, samplesRemaining);
+        for (AUAudioFrameCount i = 0; i < rampFrames; ++i) {
+            buffer[i] = inverseSlope * float(samplesRemaining - i) + _goal;
+        }
+        std::fill(buffer + rampFrames, buffer + frameCount, _goal);
+        samplesRemaining -= rampFrames;
+        return true;
+    }
+    static bool dezipperCheck(ParameterRamper* const* rampers, int count, AUAudioFrameCount rampDuration)
+    {
+        /*
+         Runs dezipperCheck() on several rampers at once and returns whether
+         any of them is ramping afterwards, so a kernel can take its
+         constant-parameter path for the whole render cycle when none is.
+         */
+        bool ramping = false;
+        for (int i = 0; i < count; ++i) {
+            rampers[i]->dezipperCheck(rampDuration);
+            ramping |= rampers[i]->isRamping();
+        }
+        return ramping;
+    }
     void stepBy(AUAudioFrameCount n)
     {
         /*
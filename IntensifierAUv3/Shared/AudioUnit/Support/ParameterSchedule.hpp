@@ -0,0 +1,62 @@
+#ifndef ParameterSchedule_h
+#define ParameterSchedule_h
+#include "DSPTypes.hpp"
+
+/*
+ ParameterSchedule
+ The parameter events of one render cycle, in time order, as frame offsets
+ into the cycle's buffers. DSPKernel::processWithEvents() fills it instead
+ of cutting the cycle at every event; the kernel's process() applies each
+ event when its rendering reaches the event's frame. Fixed capacity, so
+ filling and draining it never allocates.
+ */
+class ParameterSchedule {
+public:
+    static constexpr int kCapacity = 512;
+
+    struct Event {
+        AUAudioFrameCount frame;
+        AUParameterAddress address;
+        AUValue value;
+        AUAudioFrameCount rampDuration;
+    };
+
+    void clear() {
+        count = 0;
+        next = 0;
+    }
+    bool isFull() const {
+        return count == kCapacity;
+    }
+    // Events must be added in frame order.
+    void add(const Event& event) {
+        events[count++] = event;
+    }
+    // Drops the applied events, making room for more.
+    void compact() {
+        for (int i = next; i < count; ++i) {
+            events[i - next] = events[i];
+        }
+        count -= next;
+        next = 0;
+    }
+
+    // The frame of the next event to apply, or end if there is none before end.
+    AUAudioFrameCount nextFrame(AUAudioFrameCount end) const {
+        return next < count && events[next].frame < end ? events[next].frame : end;
+    }
+    // Takes the next event if it is due at or before frame.
+    bool pop(AUAudioFrameCount frame, Event& event) {
+        if (next == count || events[next].frame > frame) {
+            return false;
+        }
+        event = events[next++];
+        return true;
+    }
+
+private:
+    Event events[kCapacity];
+    int count = 0;
+    int next = 0;
+};
+#endif /* ParameterSchedule_h */
@@ -0,0 +1,48 @@
+#ifndef RecursiveRMS_h
+#define RecursiveRMS_h
+#include <math.h>
+
+/*
+ RecursiveRMS
+ A buffer-free stand-in for CycloneObjects::rmsaverage: the mean square is
+ a one-pole average of the squares instead of a moving window, so a
+ detector is one float of state, with no window to read and write per
+ sample. The RMS is sqrtf() of the mean square.
+
+ coefficientFor(pointCount) is 2 / (pointCount + 1), the usual one-pole
+ counterpart of a pointCount-sample window: a steady level reads the same
+ and the average delay is the same (pointCount - 1) / 2 samples. It is not
+ a replacement for the window. A step settles in exactly pointCount
+ samples in the window and leaves e^-2 (about 14%) of the change in the
+ mean square after as many samples here, and the tail decays instead of
+ ending. Through the Intensifier's slides that puts the gain several dB
+ and up to about 30 dB off the window's around transients, see
+ IntensifierDSPKernel::setRecursiveDetectors().
+
+ Squares are clamped and NaN counts as 0, as in rmsaverage. The functions
+ are branch free, for callers that keep several detectors side by side.
+ */
+namespace RecursiveRMS
+{
+    // Largest square averaged (|input| <= 64, about +36 dBFS); louder input is clamped to it.
+    constexpr float kMaxInputSquare = 4096.0f;
+
+    static inline float coefficientFor(unsigned int pointCount)
+    {
+        return pointCount > 1 ? 2.0f / (float(pointCount) + 1.0f) : 1.0f;
+    }
+
+    static inline float square(float input)
+    {
+        float result = input * input;
+        result = result == result ? result : 0.0f;
+        return result < kMaxInputSquare ? result : kMaxInputSquare;
+    }
+
+    // The mean square after input.
+    static inline float step(float meanSquare, float input, float coefficient)
+    {
+        return meanSquare + coefficient * (square(input) - meanSquare);
+    }
+}
+#endif /* RecursiveRMS_h */
@@ -0,0 +1,175 @@
+#ifndef RenderStats_h
+#define RenderStats_h
+/*
+ RenderStats
+ Optional render-thread instrumentation: time per render callback against
+ its deadline (the buffer's duration), a histogram of that load, the
+ number of missed deadlines and the time spent in each stage of the
+ kernel. Compiled in only when INTENSIFIER_RENDER_STATS is 1; otherwise
+ the INTENSIFIER_STATS_* macros expand to nothing and the class does not
+ exist.
+
+ Only the render thread writes the counters. Any other thread may read
+ them with snapshot() at any time, without locking; the fields of one
+ snapshot may be a callback apart.
+ */
+#if INTENSIFIER_RENDER_STATS
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+
+class RenderStats {
+public:
+    enum Stage {
+        kPullInput,
+        kInputGain,
+        kDetectors,
+        kGain,
+        kDelay,
+        kStageCount
+    };
+    // Load (callback time over deadline) in tenths; the last bucket holds every missed deadline.
+    static const int kHistogramBuckets = 11;
+
+    struct Snapshot {
+        uint64_t callbacks = 0;
+        uint64_t frames = 0;
+        uint64_t deadlineMisses = 0;
+        uint64_t callbackNanos = 0;
+        uint64_t deadlineNanos = 0;
+        uint64_t maxCallbackNanos = 0;
+        uint64_t stageNanos[kStageCount] = {};
+        uint64_t histogram[kHistogramBuckets] = {};
+
+        void merge(const Snapshot& other) {
+            callbacks += other.callbacks;
+            frames += other.frames;
+            deadlineMisses += other.deadlineMisses;
+            callbackNanos += other.callbackNanos;
+            deadlineNanos += other.deadlineNanos;
+            maxCallbackNanos = maxCallbackNanos > other.maxCallbackNanos ? maxCallbackNanos : other.maxCallbackNanos;
+            for (int stage = 0; stage < kStageCount; ++stage) {
+                stageNanos[stage] += other.stageNanos[stage];
+            }
+            for (int bucket = 0; bucket < kHistogramBuckets; ++bucket) {
+                histogram[bucket] += other.histogram[bucket];
+            }
+        }
+    };
+
+    static const char* stageName(int stage) {
+        static const char* const names[kStageCount] = { "pull_input", "input_gain", "detectors", "gain", "delay" };
+        return names[stage];
+    }
+
+    static uint64_t now() {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Call outside the render thread, before rendering at sampleRate.
+    void setSampleRate(double sampleRate) {
+        nanosPerFrame = 1e9 / sampleRate;
+    }
+
+    void addStage(int stage, uint64_t nanos) {
+        add(stageNanos[stage], nanos);
+    }
+
+    void addCallback(uint64_t nanos, uint32_t frameCount) {
+        uint64_t deadline = uint64_t(double(frameCount) * nanosPerFrame);
+        add(callbacks, 1);
+        add(frames, frameCount);
+        add(callbackNanos, nanos);
+        add(deadlineNanos, deadline);
+        if (nanos > maxCallbackNanos.load(std::memory_order_relaxed)) {
+            maxCallbackNanos.store(nanos, std::memory_order_relaxed);
+        }
+        int bucket = kHistogramBuckets - 1;
+        if (nanos <= deadline) {
+            bucket = deadline > 0 ? int(nanos * (kHistogramBuckets - 1) / deadline) : 0;
+            bucket = bucket < kHistogramBuckets - 1 ? bucket : kHistogramBuckets - 2;
+        } else {
+            add(deadlineMisses, 1);
+        }
+        add(histogram[bucket], 1);
+    }
+
+    Snapshot snapshot() const {
+        Snapshot result;
+        result.callbacks = callbacks.load(std::memory_order_relaxed);
+        result.frames = frames.load(std::memory_order_relaxed);
+        result.deadlineMisses = deadlineMisses.load(std::memory_order_relaxed);
+        result.callbackNanos = callbackNanos.load(std::memory_order_relaxed);
+        result.deadlineNanos = deadlineNanos.load(std::memory_order_relaxed);
+        result.maxCallbackNanos = maxCallbackNanos.load(std::memory_order_relaxed);
+        for (int stage = 0; stage < kStageCount; ++stage) {
+            result.stageNanos[stage] = stageNanos[stage].load(std::memory_order_relaxed);
+        }
+        for (int bucket = 0; bucket < kHistogramBuckets; ++bucket) {
+            result.histogram[bucket] = histogram[bucket].load(std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+    /*
+     Times one render callback. Nested timers, such as the audio unit's
+     render block around DSPKernel::processWithEvents(), count once, at the
+     outermost level.
+     */
+    class CallbackTimer {
+    public:
+        CallbackTimer(RenderStats& stats, uint32_t frameCount) : stats(stats), frameCount(frameCount), start(now()) {
+            ++stats.callbackDepth;
+        }
+        ~CallbackTimer() {
+            if (--stats.callbackDepth == 0) {
+                stats.addCallback(now() - start, frameCount);
+            }
+        }
+    private:
+        RenderStats& stats;
+        uint32_t frameCount;
+        uint64_t start;
+    };
+
+    // Splits a run of consecutive stages: each lap() charges the time since the previous one to a stage.
+    class StageClock {
+    public:
+        explicit StageClock(RenderStats& stats) : stats(stats), last(now()) {}
+        void lap(int stage) {
+            uint64_t time = now();
+            stats.addStage(stage, time - last);
+            last = time;
+        }
+    private:
+        RenderStats& stats;
+        uint64_t last;
+    };
+
+private:
+    // Single writer: a relaxed load and store is enough, and cheaper than an atomic add.
+    static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    double nanosPerFrame = 1e9 / 44100.0;
+    int callbackDepth = 0; // render thread only
+    std::atomic<uint64_t> callbacks{0};
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> deadlineMisses{0};
+    std::atomic<uint64_t> callbackNanos{0};
+    std::atomic<uint64_t> deadlineNanos{0};
+    std::atomic<uint64_t> maxCallbackNanos{0};
+    std::atomic<uint64_t> stageNanos[kStageCount] = {};
+    std::atomic<uint64_t> histogram[kHistogramBuckets] = {};
+};
+
+#define INTENSIFIER_STATS_CALLBACK(stats, frameCount) RenderStats::CallbackTimer renderStatsCallback((stats), uint32_t(frameCount))
+#define INTENSIFIER_STATS_START(stats) RenderStats::StageClock renderStatsClock(stats)
+#define INTENSIFIER_STATS_LAP(stage) renderStatsClock.lap(RenderStats::stage)
+#else
+#define INTENSIFIER_STATS_CALLBACK(stats, frameCount)
+#define INTENSIFIER_STATS_START(stats)
+#define INTENSIFIER_STATS_LAP(stage)
+#endif
+#endif /* RenderStats_h */
@@ -0,0 +1,47 @@
+#ifndef SPSCRing_h
+#define SPSCRing_h
+#include <stddef.h>
+#include <atomic>
+
+/*
+ SPSCRing
+ Fixed-size wait-free queue from exactly one producer thread to exactly one
+ consumer thread, for handing small values from the render thread to the
+ UI. Neither side locks or allocates; push() fails instead of waiting when
+ the ring is full. Capacity must be a power of two.
+ */
+template <typename T, size_t Capacity>
+class SPSCRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Producer side. Returns false, dropping value, if the consumer has fallen behind.
+    bool push(const T& value) {
+        size_t write = writeCount.load(std::memory_order_relaxed);
+        if (write - readCount.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots[write & (Capacity - 1)] = value;
+        writeCount.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if there is nothing to read.
+    bool pop(T& value) {
+        size_t read = readCount.load(std::memory_order_relaxed);
+        if (read == writeCount.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = slots[read & (Capacity - 1)];
+        readCount.store(read + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T slots[Capacity];
+    // Free-running counts, padded apart so the two threads don't write to one cache line.
+    std::atomic<size_t> writeCount{0};
+    char padding[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> readCount{0};
+};
+#endif /* SPSCRing_h */
@@ -0,0 +1,152 @@
+#include "TaskGraph.hpp"
+#include <algorithm>
+
+TaskGraph::TaskId TaskGraph::addTask(std::function<void()> work)
+{
+    Task task;
+    task.work = std::move(work);
+    tasks.push_back(std::move(task));
+    return TaskId(tasks.size() - 1);
+}
+
+void TaskGraph::addDependency(TaskId before, TaskId after)
+{
+    tasks[before].successors.push_back(after);
+    ++tasks[after].dependencyCount;
+}
+
+WorkStealingExecutor::WorkStealingExecutor(int threadCount)
+{
+    if (threadCount <= 0) {
+        threadCount = std::max(1, int(std::thread::hardware_concurrency()));
+    }
+    for (int worker = 0; worker < threadCount; ++worker) {
+        queues.emplace_back(new WorkQueue());
+    }
+    // Worker 0 is whichever thread calls run().
+    for (int worker = 1; worker < threadCount; ++worker) {
+        threads.emplace_back(&WorkStealingExecutor::workerLoop, this, worker);
+    }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingExecutor::run(TaskGraph& taskGraph)
+{
+    size_t taskCount = taskGraph.tasks.size();
+    if (taskCount == 0) {
+        return;
+    }
+    pendingDependencies.reset(new std::atomic<int>[taskCount]);
+    for (size_t task = 0; task < taskCount; ++task) {
+        pendingDependencies[task].store(taskGraph.tasks[task].dependencyCount, std::memory_order_relaxed);
+    }
+    remainingTasks.store(taskCount, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        graph = &taskGraph;
+    }
+
+    // Deal the tasks that are ready from the start out across the threads.
+    int worker = 0;
+    for (size_t task = 0; task < taskCount; ++task) {
+        if (taskGraph.tasks[task].dependencyCount == 0) {
+            push(worker, TaskGraph::TaskId(task));
+            worker = (worker + 1) % getThreadCount();
+        }
+    }
+
+    while (remainingTasks.load(std::memory_order_acquire) > 0) {
+        if (!runOne(0)) {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            wake.wait(lock, [this]() {
+                return remainingTasks.load(std::memory_order_acquire) == 0 || queuedTasks.load() > 0;
+            });
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(stateMutex);
+    graph = nullptr;
+}
+
+void WorkStealingExecutor::workerLoop(int worker)
+{
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            wake.wait(lock, [this]() { return stopping || queuedTasks.load() > 0; });
+            if (stopping) {
+                return;
+            }
+        }
+        while (runOne(worker)) {}
+    }
+}
+
+bool WorkStealingExecutor::runOne(int worker)
+{
+    TaskGraph::TaskId id;
+    if (!popOrSteal(worker, id)) {
+        return false;
+    }
+    TaskGraph::Task& task = graph->tasks[id];
+    task.work();
+    for (TaskGraph::TaskId successor : task.successors) {
+        if (pendingDependencies[successor].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            push(worker, successor);
+        }
+    }
+    if (remainingTasks.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // The last task: wake run() if it sleeps.
+        { std::lock_guard<std::mutex> lock(stateMutex); }
+        wake.notify_all();
+    }
+    return true;
+}
+
+void WorkStealingExecutor::push(int worker, TaskGraph::TaskId task)
+{
+    WorkQueue& queue = *queues[worker];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(task);
+        ++queuedTasks;
+    }
+    // Taking the state mutex orders this against a thread about to sleep, so the wakeup is not lost.
+    { std::lock_guard<std::mutex> lock(stateMutex); }
+    wake.notify_one();
+}
+
+bool WorkStealingExecutor::popOrSteal(int worker, TaskGraph::TaskId& task)
+{
+    int threadCount = getThreadCount();
+    for (int offset = 0; offset < threadCount; ++offset) {
+        int victim = (worker + offset) % threadCount;
+        WorkQueue& queue = *queues[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+        // Newest from our own queue, oldest from anyone else's.
+        if (victim == worker) {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+        } else {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+        }
+        --queuedTasks;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,100 @@
+#ifndef TaskGraph_h
+#define TaskGraph_h
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ TaskGraph
+ Units of offline work and the order they must run in. A task runs only
+ after every task added as its dependency has finished, and sees all of
+ their writes. Tasks that share state, such as the block ranges rendered
+ by one kernel, are chained so they run one after the other in order;
+ everything else may run at the same time on any thread.
+
+ As long as each piece of state is only touched by one chain, the result
+ depends on the graph alone, not on the thread count or the order the
+ executor happens to pick, so any WorkStealingExecutor renders it
+ bit-identically to a single thread.
+ */
+class TaskGraph {
+public:
+    typedef int TaskId;
+
+    // Adds a task and returns its id. Tasks must not throw.
+    TaskId addTask(std::function<void()> work);
+    // after runs once before has finished.
+    void addDependency(TaskId before, TaskId after);
+
+    size_t size() const { return tasks.size(); }
+    void clear() { tasks.clear(); }
+
+private:
+    friend class WorkStealingExecutor;
+
+    struct Task {
+        std::function<void()> work;
+        std::vector<TaskId> successors;
+        int dependencyCount = 0;
+    };
+    std::vector<Task> tasks;
+};
+
+/*
+ WorkStealingExecutor
+ Runs task graphs on a fixed pool of threads. Each thread keeps its own
+ queue: it pushes the tasks its work makes ready to the back and takes its
+ next task from the back, so a chain tends to stay on one core with its
+ state in cache. A thread that runs out of work steals from the front of
+ another thread's queue, where the oldest and usually largest pieces of
+ work wait, which keeps every core busy until the graph drains.
+
+ The queues are guarded by a mutex each, taken once per task; tasks are
+ meant to be coarse (whole block ranges), not single sub-blocks.
+ */
+class WorkStealingExecutor {
+public:
+    // threadCount threads including the caller of run(); 0 uses every core.
+    explicit WorkStealingExecutor(int threadCount = 0);
+    ~WorkStealingExecutor();
+    WorkStealingExecutor(const WorkStealingExecutor&) = delete;
+    WorkStealingExecutor& operator=(const WorkStealingExecutor&) = delete;
+
+    int getThreadCount() const { return int(queues.size()); }
+
+    // Runs every task of graph and returns once they have all finished. The calling thread works too.
+    void run(TaskGraph& graph);
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<TaskGraph::TaskId> tasks;
+    };
+
+    void workerLoop(int worker);
+    // Runs one task if worker can find one, and returns whether it did.
+    bool runOne(int worker);
+    void push(int worker, TaskGraph::TaskId task);
+    bool popOrSteal(int worker, TaskGraph::TaskId& task);
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> threads;
+
+    // Guards sleeping and waking; the counts themselves are atomic.
+    std::mutex stateMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::atomic<int> queuedTasks{0};
+
+    // The graph being run.
+    TaskGraph* graph = nullptr;
+    std::unique_ptr<std::atomic<int>[]> pendingDependencies;
+    std::atomic<size_t> remainingTasks{0};
+};
+#endif /* TaskGraph_h */
@@ -1,81 +1,115 @@
 #include "rmsaverage.h"
+#include <algorithm>
 
 namespace CycloneObjects {
+    constexpr double rmsaverage::kMaxInputSquare;
+    constexpr double rmsaverage::kRoundingOffset;
+
+    namespace {
+        const unsigned int kBufferMaxSize = 882000; // 20 seconds
+        // Squares are quantized this many samples at a time, on the stack.
+        const int kChunkSize = 256;
+    }
+
     void rmsaverage::init(double sampleRate, unsigned int pointCount)
+    {
+        ownedBuffer.resize(storageSize(pointCount));
+        init(sampleRate, pointCount, ownedBuffer.data());
+    }
+    void rmsaverage::init(double sampleRate, unsigned int pointCount, double* storage)
     {
         sampleRateHz = sampleRate;
-        bufferMaxSize = 882000; // 20 seconds
+        bufferMaxSize = kBufferMaxSize;
 
-        if (pointCount <= bufferMaxSize)
-        {
-            buffer.resize(pointCount);
-        }
-        else
-        {
-            buffer.resize(bufferMaxSize);
-        }
+        npoints = storageSize(pointCount);
+        buffer = storage;
+        squareScale = squareScaleFor(pointCount);
+        outputScale = outputScaleFor(pointCount);
         clear();
         output = 0.0f;
-        npoints = pointCount;
+    }
+    double rmsaverage::squareScaleFor(unsigned int pointCount)
+    {
+        /*
+         Scale the squares so that npoints of the largest one sum to at most
+         2^53, the end of the range where doubles hold every integer. Starting
+         at one bit also keeps each square within the rounding range.
+         */
+        unsigned int points = storageSize(pointCount);
+        int windowBits = 1;
+        while ((1u << windowBits) < points) {
+            ++windowBits;
+        }
+        return ldexp(1.0, 53 - windowBits) / kMaxInputSquare;
+    }
+    float rmsaverage::outputScaleFor(unsigned int pointCount)
+    {
+        return float(1.0 / (squareScaleFor(pointCount) * storageSize(pointCount)));
+    }
+    unsigned int rmsaverage::storageSize(unsigned int pointCount)
+    {
+        return std::max(1u, std::min(pointCount, kBufferMaxSize));
     }
     void rmsaverage::deinit()
     {
-        buffer.clear();
+        ownedBuffer.clear();
+        buffer = nullptr;
+        npoints = 0;
     }
     void rmsaverage::clear()
     {
-        sampleCount = 0;
-        accum = 0;
+        accum = 0.0;
         readIndex = 0;
-        std::fill(buffer.begin(), buffer.end(), 0.0f);
+        if (buffer != nullptr) {
+            std::fill(buffer, buffer + npoints, 0.0);
+        }
     }
     float rmsaverage::push(float input)
     {
-        if (buffer.empty()) return input;
-        unsigned int points = npoints;
-        float result = 0; // eventual result
-        if (points > 1) {
-            unsigned int bufrd = readIndex;
-            accum = rmssum(input, accum, 1);
-            calib = rmssum(input, calib, 1);
-            unsigned int count = sampleCount;
-            if(count < npoints) {
-                //update count
-                count++;
-                sampleCount = count;
-            } else {
-                accum = rmssum(buffer[bufrd], accum, 0);
-            };
-
-            // overwrite/store current input value into buf
-            buffer[bufrd] = input;
+        float result;
+        process(&input, &result, 1);
+        return result;
+    }
+    void rmsaverage::process(const float* in, float* out, int count)
+    {
+        if (count <= 0) {
+            return;
+        }
+        if (buffer == nullptr) {
+            std::copy(in, in + count, out);
+            output = out[count - 1];
+            return;
+        }
+        double delta[kChunkSize];
+        int done = 0;
+        while (done < count) {
+            // Stop at the end of the ring buffer or the scratch, whichever comes first.
+            int chunk = std::min(count - done, std::min(kChunkSize, int(npoints - readIndex)));
+            const float* chunkIn = in + done;
+            float* chunkOut = out + done;
+            double* window = buffer + readIndex;
 
-            //calculate result
-            result = accum/(float)npoints;
-            result = sqrt(result);
+            // Quantize the new squares and swap them into the window.
+            for (int i = 0; i < chunk; ++i) {
+                double quantized = quantizedSquare(chunkIn[i], squareScale);
+                delta[i] = quantized - window[i];
+                window[i] = quantized;
+            }
+            // Running sum; exact, so the order of the additions doesn't matter.
+            double sum = accum;
+            for (int i = 0; i < chunk; ++i) {
+                sum += delta[i];
+                chunkOut[i] = float(sum) * outputScale;
+            }
+            accum = sum;
+            for (int i = 0; i < chunk; ++i) {
+                chunkOut[i] = sqrtf(chunkOut[i]);
+            }
 
-            // incrementation step
-            bufrd++;
-            if (bufrd >= npoints) {
-                bufrd = 0;
-                accum = calib;
-                calib = 0.0f;
-            };
-            readIndex = bufrd;
-        } else {
-            result = fabs(input);
+            readIndex += chunk;
+            readIndex = readIndex == npoints ? 0 : readIndex;
+            done += chunk;
         }
-        if (isnan(result))
-            result = input;
-        return (output = result);
-    }
-    double rmsaverage::rmssum(float input, float accum, int add)
-    {
-        if (add) {
-            accum += (input * input);
-        } else {
-            accum -= (input * input);
-        };
-        return (accum);
+        output = out[count - 1];
     }
 }
@@ -4,24 +4,66 @@
 #include <math.h>
 namespace CycloneObjects
 {
+    /*
+     Moving RMS over the last npoints samples.
+
+     Squared inputs are quantized to integers (scaled by a power of two chosen
+     from npoints) and kept in a double running sum. Every partial sum is an
+     integer below 2^53, so adding the new square and subtracting the oldest
+     is exact: the sum never drifts, needs no recalibration, and the output
+     does not depend on how the input is split into blocks. Squares are
+     clamped to 4096 (|input| <= 64, about +36 dBFS) and NaN counts as 0.
+     */
     class rmsaverage {
     public:
         ~rmsaverage() { deinit(); }
         void init(double sampleRate, unsigned int pointCount);
+        /*
+         Same, but keeps the window in storage, which must hold
+         storageSize(pointCount) doubles and outlive the object. Real-time
+         safe: nothing is allocated.
+         */
+        void init(double sampleRate, unsigned int pointCount, double* storage);
+        static unsigned int storageSize(unsigned int pointCount);
         void deinit();
         void clear();
         float push(float input);
+        // Block version of push(). in and out may be the same buffer.
+        void process(const float* in, float* out, int count);
         float getOutput() { return output; }
+
+        /*
+         The quantization for a window of pointCount samples, for callers that
+         keep several windows side by side: a window's sum is the sum of
+         quantizedSquare(input, squareScaleFor(pointCount)) over its samples,
+         and its RMS is sqrtf(float(sum) * outputScaleFor(pointCount)).
+         */
+        static double squareScaleFor(unsigned int pointCount);
+        static float outputScaleFor(unsigned int pointCount);
+        static double quantizedSquare(float input, double squareScale)
+        {
+            float square = input * input;
+            square = square == square ? square : 0.0f;
+            double quantized = double(square) * squareScale;
+            double maxSquare = kMaxInputSquare * squareScale;
+            quantized = maxSquare < quantized ? maxSquare : quantized;
+            return (quantized + kRoundingOffset) - kRoundingOffset;
+        }
     private:
-        float accum; // sum
-        float calib; // accumulator calibrator
-        std::vector<float> buffer;
-        unsigned int sampleCount; // number of samples seen so far
-        unsigned int npoints; // number of samples for moving average
+        // Largest square kept exactly; louder input is clamped to it.
+        static constexpr double kMaxInputSquare = 4096.0;
+        // Adding and subtracting 2^52 rounds 0 <= x <= 2^52 to the nearest integer.
+        static constexpr double kRoundingOffset = 4503599627370496.0;
+
+        double accum; // exact sum of the quantized squares in buffer
+        std::vector<double> ownedBuffer; // backs buffer when no storage is given
+        double* buffer = nullptr; // npoints quantized squares, oldest at readIndex
+        unsigned int npoints = 0; // number of samples for moving average
         unsigned int readIndex;
         double sampleRateHz;
         unsigned int bufferMaxSize;
+        double squareScale; // input * input to quantized square
+        float outputScale; // accum to mean square
         float output;
-        double rmssum(float input, float accum, int add);
     };
 }
@@ -2,10 +2,8 @@
 namespace CycloneObjects {
     void slide::init(float slideUpSamples, float slideDownSamples)
     {
-        float f1 = slideup;
-        float f2 = slidedown;
-        setslideup(f1);
-        setslidedown(f2);
+        setslideup(slideUpSamples);
+        setslidedown(slideDownSamples);
         clear();
     }
     void slide::clear()
@@ -14,43 +12,14 @@ namespace CycloneObjects {
     }
     void slide::push(float input)
     {
-        output = 0.0;
-        if (input >= last) {
-            if (slideup > 1.0f)
-                output = last + ((input - last) / slideup);
-            else
-                output = last = input;
-        } else if (input < last) {
-            if (slidedown > 1)
-                output = last + ((input - last) / slidedown);
-            else
-                output = last = input;
-        }
-        if (output == last && output != input)
-            output = input;
-        if (isnan(output))
-            output = input;
-
-        last = output;
+        output = last = step(input, last, slideup, slidedown);
     }
     void slide::setslideup(float f)
     {
-        int i = (int)f;
-        if (i > 1)
-        {
-            slideup = i;
-        } else {
-            slideup = 0;
-        }
+        slideup = (int)samples(f);
     }
     void slide::setslidedown(float f)
     {
-        int i = (int)f;
-        if (i > 1)
-        {
-            slidedown = i;
-        } else {
-            slidedown = 0;
-        }
+        slidedown = (int)samples(f);
     }
 }
@@ -10,6 +10,30 @@ namespace CycloneObjects
         float getOutput() { return output; }
         void setslideup(float f);
         void setslidedown(float f);
+
+        // Slide length as used by push(): whole samples, or 0 for no slide.
+        static float samples(float f)
+        {
+            int i = (int)f;
+            return i > 1 ? (float)i : 0.0f;
+        }
+        /*
+         One branch-free slide step. Shared by push() and by callers that keep
+         the slide state for several channels side by side. The division
+         runs whether or not its result is used, so that compilers which may
+         not speculate a division can still turn the selects into vector
+         blends.
+         */
+        static float step(float input, float last, float slideUpSamples, float slideDownSamples)
+        {
+            float slideSamples = input >= last ? slideUpSamples : slideDownSamples;
+            bool sliding = slideSamples > 1.0f;
+            float stepped = last + ((input - last) / (sliding ? slideSamples : 1.0f));
+            float result = sliding ? stepped : input;
+            // Snap to the input once the step no longer moves the output.
+            result = result == last ? input : result;
+            return result != result ? input : result;
+        }
     private:
         int slideup;
         int slidedown;
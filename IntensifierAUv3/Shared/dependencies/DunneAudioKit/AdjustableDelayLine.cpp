@@ -51,7 +51,7 @@ namespace DunneCore
         
         int ri = int(readIndex);
         float f = readIndex - ri;
-        int rj = ri + 1; if (rj >= capacity) rj -= capacity;
+        int rj = ri + 1; if (rj >= int(capacity)) rj -= int(capacity);
         readIndex += 1.0f;
         if (readIndex >= capacity) readIndex -= capacity;
         
@@ -60,7 +60,7 @@ namespace DunneCore
         float outSample = (1.0f - f) * si + f * sj;
         
         buffer[writeIndex++] = sample + fbFraction * outSample;
-        if (writeIndex >= capacity) writeIndex = 0;
+        if (writeIndex >= int(capacity)) writeIndex = 0;
         
         return (output = outSample);
     }
@@ -3,6 +3,12 @@ var card = document.querySelector('.js-profile-card');
 
 var app = angular.module('IntensifierAUv3', []);
 
+// Latest meter reading, pushed by the audio unit's view about 30 times a second while it is visible.
+window.intensifierMeter = null;
+window.updateMeter = function (reading) {
+    window.intensifierMeter = reading;
+};
+
 app.controller('IntensifierCtrl', function($scope) {
     var presets = ["Subtle", "W I D E", "CrOnchy"];
     var gpresetNum;
@@ -0,0 +1,1384 @@
+/*
+ intensifier-bench
+ Microbenchmarks for the render hot paths: CycloneObjects::rmsaverage::push
+ and process, CycloneObjects::slide::push, DunneCore::AdjustableDelayLine::push,
+ LookaheadDelay::process and IntensifierDSPKernel::process. The kernel is
+ measured across block sizes, sample rates, channel counts and with static
+ or continuously ramping parameters, on silent input, and on the subnormal
+ end of a decaying tail with and without flushing subnormals to zero.
+ Host automation through processWithEvents is measured sparse (one event
+ per 1024 frames) and dense (a per-sample curve on two parameters), with
+ the events scheduled into one pass or splitting the cycle (kernel.events).
+ Sessions of many stereo instances are measured both as separate kernels
+ (instances.process) and as one IntensifierBatchKernel (batch.process).
+
+ Prints one CSV row per case to stdout:
+   benchmark,sample_rate,channels,block_frames,parameters,detector_decimation,frames,seconds,ns_per_sample,realtime_factor
+ ns_per_sample counts every channel of every frame. realtime_factor is audio
+ time over wall time for the whole (multichannel) stream. Per-sample
+ primitives leave block_frames, parameters and detector_decimation empty.
+
+ --recursive-detectors runs the kernel cases with the recursive RMS
+ detectors (see IntensifierDSPKernel::setRecursiveDetectors()), and
+ --detector-link MODE with linked detectors (see setDetectorLink()).
+
+ --deviation instead measures how far the decimated detector modes (see
+ IntensifierDSPKernel::setDetectorDecimation()) are from the full-rate
+ detectors on each factory preset, as the gain difference in dB over the
+ samples where the full-rate output is above -60 dBFS:
+   preset,sample_rate,detector_decimation,max_db,p999_db,p99_db,median_db
+ With --recursive-detectors it measures the recursive detectors, at full
+ rate (detector_decimation 1) and decimated, against the full-rate
+ windowed ones.
+
+ --check instead compares the optimized kernels against the frozen
+ IntensifierReferenceKernel, on a corpus of signals (impulses, noise
+ bursts between digital silence, a sine sweep and noise at stepped levels)
+ at every factory preset:
+   check,path,signal,preset,sample_rate,value,limit,result
+ accuracy rows give the 99th percentile of the per-sample difference from
+ the reference, relative to its peak, and accuracy-max rows the largest,
+ for IntensifierDSPKernel in 512-frame cycles (kernel) and for
+ IntensifierBatchKernel (batch), in stereo and, with the channel count in
+ the path, in mono, on 3 channels (the generic render path) and on 6 and
+ 8. kernel-automation paths render host automation, ramps and immediate
+ changes of every parameter off the cycle boundaries, scheduled into one
+ pass and splitting the cycle (-split), against the reference ramped at
+ the same frames. kernel-max, kernel-average and kernel-mid link the
+ detectors, on the same signal on every channel, where linking must not
+ change the sound. The two accuracy rows are checked separately because
+ the slides snap to their input once a step is lost in float rounding:
+ a difference of an ulp can move a snap by a sample, which leaves a small
+ share of isolated samples off by up to a few tenths of a percent of the
+ peak while the rest agree to within about 1e-5. The reference's RMS
+ windows keep the original float running sums, which round differently
+ from the kernels' exact ones; where a long slide hovers at its snapping
+ point that can shift a whole stretch of samples, by up to about 5e-4 of
+ the peak at the 99th percentile (the sweep through W I D E at 96 kHz),
+ hence the default --tolerance of 1e-3. blocks rows give the largest
+ difference between the kernel rendered in cycles of random lengths and
+ in 512-frame cycles, which must be none, for each of those paths and for
+ the decimated and recursive detectors. deviation rows give the 99th
+ percentile deviation of the decimated and recursive detectors, as
+ --deviation measures it, which must stay within 0.5 dB of the figures
+ documented in IntensifierDSPKernel. On a signal with a 16 s gap of
+ digital silence, silence-skip rows give the seconds the kernel takes to
+ settle and skip the silence, which must end within the gap, and
+ silence-flag rows count the cycles that takeOutputIsSilence() flags
+ silent although they sound, there and bypassed, which must be none.
+ speed rows give ns_per_sample over the fastest of repeated renders; the
+ kernel's must beat the reference's (path reference). The speed-baseline
+ row compares them with the committed check-baseline.csv, or --baseline:
+ the kernel's speed relative to the reference's, over the geometric mean
+ of the rows, must stay within --max-slowdown of the baseline's. Refresh
+ the baseline from a full --check run (its header and speed rows) when a
+ change makes the kernel faster. Exits with 1 if any row fails.
+ */
+#include "IntensifierDSPKernel.hpp"
+#include "IntensifierBatchKernel.hpp"
+#include "IntensifierPresets.hpp"
+#include "ReferenceKernel.hpp"
+#include "AdjustableDelayLine.h"
+#include "LookaheadDelay.hpp"
+#include "rmsaverage.h"
+#include "slide.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The committed --check output whose speed rows --check compares with by default.
+#ifndef INTENSIFIER_CHECK_BASELINE
+#define INTENSIFIER_CHECK_BASELINE "check-baseline.csv"
+#endif
+
+namespace {
+    struct BenchmarkOptions {
+        double minSeconds = 0.1;
+        std::string filter;
+        bool quick = false;
+        int detectorDecimation = 1;
+        bool recursiveDetectors = false;
+        IntensifierDSPKernel::DetectorLink detectorLink = IntensifierDSPKernel::kDetectorLinkOff;
+        bool deviation = false;
+        bool check = false;
+        double tolerance = 1e-3;
+        double maxTolerance = 0.01;
+        std::string baselinePath = INTENSIFIER_CHECK_BASELINE;
+        double maxSlowdown = 1.25;
+    };
+
+    struct BenchmarkResult {
+        uint64_t frames = 0;
+        double seconds = 0.0;
+    };
+
+    // Keeps the optimizer from discarding the benchmarked work.
+    volatile float sink;
+
+    const int kSignalSeconds = 1;
+
+    // Deterministic test signal: noise bursts over a quiet tone, so the detectors see both attacks and releases.
+    std::vector<float> makeSignal(double sampleRate, int channel)
+    {
+        std::vector<float> signal(size_t(sampleRate * kSignalSeconds));
+        uint32_t seed = 0x9E3779B9u * uint32_t(channel + 1);
+        size_t burstFrames = size_t(sampleRate / 10);
+        for (size_t frame = 0; frame < signal.size(); ++frame) {
+            seed = seed * 1664525u + 1013904223u;
+            float noise = float(int32_t(seed)) / 2147483648.0f;
+            float tone = 0.05f * sinf(float(frame) * 0.031f);
+            signal[frame] = (frame / burstFrames) % 2 ? 0.7f * noise : tone;
+        }
+        return signal;
+    }
+
+    // The end of a decaying tail: noise falling from 1e-30 into the subnormal range and on to zero.
+    std::vector<float> makeTail(double sampleRate, int channel)
+    {
+        std::vector<float> signal = makeSignal(sampleRate, channel);
+        double decayPerFrame = pow(1e-17, 1.0 / double(signal.size()));
+        double level = 1e-30;
+        for (float& sample : signal) {
+            sample = float(sample * level);
+            level *= decayPerFrame;
+        }
+        return signal;
+    }
+
+    // Calls run(frames) in batches until at least minSeconds of wall time have passed.
+    template <typename Run>
+    BenchmarkResult measure(const BenchmarkOptions& options, uint64_t batchFrames, Run run)
+    {
+        run(batchFrames); // Warm up caches and branch predictors.
+        BenchmarkResult result;
+        auto start = std::chrono::steady_clock::now();
+        do {
+            run(batchFrames);
+            result.frames += batchFrames;
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (result.seconds < options.minSeconds);
+        return result;
+    }
+
+    void report(const char* benchmark, double sampleRate, int channels, int blockFrames, const char* parameters, int detectorDecimation, const BenchmarkResult& result)
+    {
+        double samples = double(result.frames) * channels;
+        double audioSeconds = double(result.frames) / sampleRate;
+        std::string block = blockFrames > 0 ? std::to_string(blockFrames) : std::string();
+        std::string decimation = detectorDecimation > 0 ? std::to_string(detectorDecimation) : std::string();
+        printf("%s,%.0f,%d,%s,%s,%s,%llu,%.6f,%.4f,%.2f\n", benchmark, sampleRate, channels, block.c_str(), parameters, decimation.c_str(),
+               (unsigned long long)result.frames, result.seconds, result.seconds * 1e9 / samples, audioSeconds / result.seconds);
+        fflush(stdout);
+    }
+
+    bool selected(const BenchmarkOptions& options, const char* benchmark)
+    {
+        return options.filter.empty() || strstr(benchmark, options.filter.c_str()) != nullptr;
+    }
+
+    void benchmarkRMSAverage(const BenchmarkOptions& options, double sampleRate)
+    {
+        std::vector<float> signal = makeSignal(sampleRate, 0);
+        CycloneObjects::rmsaverage rms;
+        rms.init(sampleRate, 441);
+        size_t position = 0;
+        BenchmarkResult result = measure(options, signal.size(), [&](uint64_t frames) {
+            float sum = 0.0f;
+            for (uint64_t i = 0; i < frames; ++i) {
+                sum += rms.push(signal[position]);
+                position = position + 1 == signal.size() ? 0 : position + 1;
+            }
+            sink = sum;
+        });
+        report("rmsaverage.push", sampleRate, 1, 0, "", 0, result);
+    }
+
+    void benchmarkRMSAverageBlock(const BenchmarkOptions& options, double sampleRate, int blockFrames)
+    {
+        std::vector<float> signal = makeSignal(sampleRate, 0);
+        std::vector<float> output(blockFrames);
+        size_t signalFrames = signal.size() - signal.size() % size_t(blockFrames);
+        CycloneObjects::rmsaverage rms;
+        rms.init(sampleRate, 441);
+        size_t position = 0;
+        BenchmarkResult result = measure(options, signalFrames, [&](uint64_t frames) {
+            float sum = 0.0f;
+            for (uint64_t done = 0; done < frames; done += blockFrames) {
+                rms.process(signal.data() + position, output.data(), blockFrames);
+                sum += output[0];
+                position = position + blockFrames == signalFrames ? 0 : position + blockFrames;
+            }
+            sink = sum;
+        });
+        report("rmsaverage.process", sampleRate, 1, blockFrames, "", 0, result);
+    }
+
+    void benchmarkSlide(const BenchmarkOptions& options, double sampleRate)
+    {
+        std::vector<float> signal = makeSignal(sampleRate, 0);
+        CycloneObjects::slide slide;
+        slide.init(CycloneObjects::slide::samples(float(sampleRate) * 0.149f), CycloneObjects::slide::samples(float(sampleRate)));
+        size_t position = 0;
+        BenchmarkResult result = measure(options, signal.size(), [&](uint64_t frames) {
+            float sum = 0.0f;
+            for (uint64_t i = 0; i < frames; ++i) {
+                slide.push(fabsf(signal[position]));
+                sum += slide.getOutput();
+                position = position + 1 == signal.size() ? 0 : position + 1;
+            }
+            sink = sum;
+        });
+        report("slide.push", sampleRate, 1, 0, "", 0, result);
+    }
+
+    void benchmarkDelay(const BenchmarkOptions& options, double sampleRate)
+    {
+        std::vector<float> signal = makeSignal(sampleRate, 0);
+        DunneCore::AdjustableDelayLine delay;
+        delay.init(sampleRate, 10);
+        delay.setDelayMs(20.0);
+        delay.setFeedback(0.0);
+        size_t position = 0;
+        BenchmarkResult result = measure(options, signal.size(), [&](uint64_t frames) {
+            float sum = 0.0f;
+            for (uint64_t i = 0; i < frames; ++i) {
+                sum += delay.push(signal[position]);
+                position = position + 1 == signal.size() ? 0 : position + 1;
+            }
+            sink = sum;
+        });
+        report("delay.push", sampleRate, 1, 0, "", 0, result);
+    }
+
+    void benchmarkLookahead(const BenchmarkOptions& options, double sampleRate, int blockFrames)
+    {
+        std::vector<float> signal = makeSignal(sampleRate, 0);
+        std::vector<float> output(blockFrames);
+        size_t signalFrames = signal.size() - signal.size() % size_t(blockFrames);
+        size_t delayFrames = size_t(lround(sampleRate / 100.0));
+        std::vector<float> storage(LookaheadDelay::storageSize(delayFrames, blockFrames));
+        LookaheadDelay delay;
+        delay.init(delayFrames, blockFrames, storage.data());
+        delay.setDelayFrames(delayFrames);
+        size_t position = 0;
+        BenchmarkResult result = measure(options, signalFrames, [&](uint64_t frames) {
+            float sum = 0.0f;
+            for (uint64_t done = 0; done < frames; done += blockFrames) {
+                delay.process(signal.data() + position, output.data(), blockFrames);
+                sum += output[0];
+                position = position + blockFrames == signalFrames ? 0 : position + blockFrames;
+            }
+            sink = sum;
+        });
+        report("lookahead.process", sampleRate, 1, blockFrames, "", 0, result);
+    }
+
+    enum KernelCase {
+        kStaticParameters,
+        kRampingParameters,
+        // Static parameters and digital silence at the input.
+        kSilentInput,
+        // Static parameters on a decaying tail, with and without flushing subnormals.
+        kDecayingTail,
+        kDecayingTailWithDenormals
+    };
+
+    void benchmarkKernel(const BenchmarkOptions& options, double sampleRate, int channelCount, int blockFrames, KernelCase kernelCase)
+    {
+        bool ramping = kernelCase == kRampingParameters;
+        bool tail = kernelCase == kDecayingTail || kernelCase == kDecayingTailWithDenormals;
+        std::vector<std::vector<float>> input;
+        std::vector<std::vector<float>> output(channelCount, std::vector<float>(blockFrames));
+        for (int channel = 0; channel < channelCount; ++channel) {
+            if (kernelCase == kSilentInput) {
+                input.push_back(std::vector<float>(size_t(sampleRate * kSignalSeconds)));
+            } else {
+                input.push_back(tail ? makeTail(sampleRate, channel) : makeSignal(sampleRate, channel));
+            }
+        }
+        size_t signalFrames = input[0].size() - input[0].size() % size_t(blockFrames);
+
+        const IntensifierPreset& preset = IntensifierFactoryPresets[0];
+        const IntensifierPreset& target = IntensifierFactoryPresets[2];
+        IntensifierDSPKernel kernel;
+        for (int address = 0; address < 6; ++address) {
+            kernel.setParameter(address, preset.values[address]);
+        }
+        kernel.setDetectorDecimation(options.detectorDecimation);
+        kernel.setRecursiveDetectors(options.recursiveDetectors);
+        kernel.setDetectorLink(options.detectorLink);
+        kernel.setFlushDenormals(kernelCase != kDecayingTailWithDenormals);
+        kernel.init(channelCount, sampleRate);
+        kernel.reset();
+
+        const float* inBuffers[IntensifierDSPKernel::kMaxChannels];
+        float* outBuffers[IntensifierDSPKernel::kMaxChannels];
+        for (int channel = 0; channel < channelCount; ++channel) {
+            outBuffers[channel] = output[channel].data();
+        }
+        size_t position = 0;
+        uint64_t blockIndex = 0;
+        // Round the batch to whole blocks of roughly 10 ms.
+        uint64_t batchFrames = std::max<uint64_t>(1, uint64_t(sampleRate / 100) / blockFrames) * blockFrames;
+        BenchmarkResult result = measure(options, batchFrames, [&](uint64_t frames) {
+            float sum = 0.0f;
+            for (uint64_t done = 0; done < frames; done += blockFrames, ++blockIndex) {
+                if (ramping) {
+                    // Restart every ramp before it ends, swinging between two presets, so the rampers never settle.
+                    const IntensifierPreset& next = blockIndex % 2 ? preset : target;
+                    for (int address = 0; address < 6; ++address) {
+                        kernel.startRamp(address, next.values[address], AUAudioFrameCount(blockFrames * 2));
+                    }
+                }
+                for (int channel = 0; channel < channelCount; ++channel) {
+                    inBuffers[channel] = input[channel].data() + position;
+                }
+                kernel.setBuffers(inBuffers, outBuffers);
+                kernel.process(AUAudioFrameCount(blockFrames), 0);
+                sum += output[0][0];
+                position += blockFrames;
+                if (position >= signalFrames) {
+                    position = 0;
+                }
+            }
+            sink = sum;
+        });
+        const char* const parameterNames[] = { "static", "ramping", "silent", "tail", "tail-denormals" };
+        const char* parameters = parameterNames[kernelCase];
+        report("kernel.process", sampleRate, channelCount, blockFrames, parameters, kernel.getDetectorDecimation(), result);
+    }
+
+    /*
+     Stereo kernel driven through processWithEvents with host automation:
+     sparse, one input gain event every 1024 frames, or dense, an event on
+     every frame for both the input and attack amounts, each ramping to the
+     next point of a curve over one frame. scheduled selects whether the
+     kernel takes the events into one pass or lets the cycle be split.
+     */
+    void benchmarkEvents(const BenchmarkOptions& options, double sampleRate, int blockFrames, bool dense, bool scheduled)
+    {
+        const int channelCount = 2;
+        std::vector<std::vector<float>> input;
+        for (int channel = 0; channel < channelCount; ++channel) {
+            input.push_back(makeSignal(sampleRate, channel));
+        }
+        std::vector<std::vector<float>> output(channelCount, std::vector<float>(blockFrames));
+        size_t signalFrames = input[0].size() - input[0].size() % size_t(blockFrames);
+
+        const IntensifierPreset& preset = IntensifierFactoryPresets[0];
+        IntensifierDSPKernel kernel;
+        for (int address = 0; address < 6; ++address) {
+            kernel.setParameter(address, preset.values[address]);
+        }
+        kernel.setSchedulesParameterEvents(scheduled);
+        kernel.init(channelCount, sampleRate);
+        kernel.reset();
+
+        const int sparseInterval = 1024;
+        std::vector<AURenderEvent> events(size_t(blockFrames) * 2);
+        const float* inBuffers[channelCount];
+        float* outBuffers[channelCount] = { output[0].data(), output[1].data() };
+        size_t position = 0;
+        uint64_t sampleTime = 0;
+        uint64_t batchFrames = std::max<uint64_t>(1, uint64_t(sampleRate / 100) / blockFrames) * blockFrames;
+        BenchmarkResult result = measure(options, batchFrames, [&](uint64_t frames) {
+            float sum = 0.0f;
+            for (uint64_t done = 0; done < frames; done += blockFrames) {
+                // Build this cycle's event list.
+                AURenderEvent* previous = nullptr;
+                AURenderEvent* first = nullptr;
+                size_t eventCount = 0;
+                for (int frame = 0; frame < blockFrames; ++frame) {
+                    uint64_t time = sampleTime + frame;
+                    if (!dense && time % sparseInterval != 0) {
+                        continue;
+                    }
+                    int parameterCount = dense ? 2 : 1;
+                    for (int i = 0; i < parameterCount; ++i) {
+                        AURenderEvent& event = events[eventCount++];
+                        event = AURenderEvent();
+                        event.parameter.eventSampleTime = AUEventSampleTime(time);
+                        event.parameter.eventType = AURenderEventParameterRamp;
+                        event.parameter.rampDurationSampleFrames = 1;
+                        event.parameter.parameterAddress = i == 0 ? IntensifierParamInputAmount : IntensifierParamAttackAmount;
+                        event.parameter.value = 6.0f * sinf(float(time) * 0.0005f);
+                        if (previous != nullptr) {
+                            previous->head.next = &event;
+                        } else {
+                            first = &event;
+                        }
+                        previous = &event;
+                    }
+                }
+                for (int channel = 0; channel < channelCount; ++channel) {
+                    inBuffers[channel] = input[channel].data() + position;
+                }
+                kernel.setBuffers(inBuffers, outBuffers);
+                AudioTimeStamp timestamp = {};
+                timestamp.mSampleTime = double(sampleTime);
+                kernel.processWithEvents(&timestamp, AUAudioFrameCount(blockFrames), first, nullptr);
+                sum += output[0][0];
+                sampleTime += blockFrames;
+                position += blockFrames;
+                if (position >= signalFrames) {
+                    position = 0;
+                }
+            }
+            sink = sum;
+        });
+        const char* const parameterNames[2][2] = { { "sparse-split", "sparse-scheduled" }, { "dense-split", "dense-scheduled" } };
+        report("kernel.events", sampleRate, channelCount, blockFrames, parameterNames[dense][scheduled], 1, result);
+    }
+
+    /*
+     A session of instanceCount stereo instances cycling through the factory
+     presets, rendered as separate kernels or as one batch.
+     */
+    void benchmarkSession(const BenchmarkOptions& options, double sampleRate, int instanceCount, int blockFrames, bool batched)
+    {
+        const int channelCount = 2;
+        std::vector<std::vector<float>> input;
+        for (int channel = 0; channel < channelCount; ++channel) {
+            input.push_back(makeSignal(sampleRate, channel));
+        }
+        size_t signalFrames = input[0].size() - input[0].size() % size_t(blockFrames);
+        std::vector<std::vector<float>> output(instanceCount * channelCount, std::vector<float>(blockFrames));
+
+        std::vector<std::unique_ptr<IntensifierDSPKernel>> kernels;
+        IntensifierBatchKernel batch;
+        std::vector<int> ids;
+        if (batched) {
+            batch.init(instanceCount, instanceCount * channelCount, sampleRate);
+            for (int instance = 0; instance < instanceCount; ++instance) {
+                ids.push_back(batch.addInstance(channelCount, IntensifierFactoryPresets[instance % IntensifierFactoryPresetCount].values));
+            }
+            batch.applyPendingChanges();
+        } else {
+            for (int instance = 0; instance < instanceCount; ++instance) {
+                kernels.emplace_back(new IntensifierDSPKernel());
+                const IntensifierPreset& preset = IntensifierFactoryPresets[instance % IntensifierFactoryPresetCount];
+                for (int address = 0; address < 6; ++address) {
+                    kernels.back()->setParameter(address, preset.values[address]);
+                }
+                kernels.back()->setRecursiveDetectors(options.recursiveDetectors);
+                kernels.back()->setDetectorLink(options.detectorLink);
+                kernels.back()->init(channelCount, sampleRate);
+                kernels.back()->reset();
+            }
+        }
+
+        size_t position = 0;
+        uint64_t batchFrames = std::max<uint64_t>(1, uint64_t(sampleRate / 100) / blockFrames) * blockFrames;
+        BenchmarkResult result = measure(options, batchFrames, [&](uint64_t frames) {
+            float sum = 0.0f;
+            for (uint64_t done = 0; done < frames; done += blockFrames) {
+                const float* inBuffers[channelCount] = { input[0].data() + position, input[1].data() + position };
+                for (int instance = 0; instance < instanceCount; ++instance) {
+                    float* outBuffers[channelCount] = { output[instance * channelCount].data(), output[instance * channelCount + 1].data() };
+                    if (batched) {
+                        batch.setBuffers(ids[instance], inBuffers, outBuffers);
+                    } else {
+                        kernels[instance]->setBuffers(inBuffers, outBuffers);
+                        kernels[instance]->process(AUAudioFrameCount(blockFrames), 0);
+                    }
+                }
+                if (batched) {
+                    batch.process(AUAudioFrameCount(blockFrames));
+                }
+                sum += output[0][0];
+                position += blockFrames;
+                if (position >= signalFrames) {
+                    position = 0;
+                }
+            }
+            sink = sum;
+        });
+        report(batched ? "batch.process" : "instances.process", sampleRate, instanceCount * channelCount, blockFrames, "static", 1, result);
+    }
+
+    // Renders channel 0 of the test signal with preset, with the given detectors, in 512-frame blocks.
+    std::vector<float> renderPreset(const IntensifierPreset& preset, double sampleRate, int detectorDecimation, bool recursiveDetectors)
+    {
+        std::vector<float> audio = makeSignal(sampleRate, 0);
+        IntensifierDSPKernel kernel;
+        for (int address = 0; address < 6; ++address) {
+            kernel.setParameter(address, preset.values[address]);
+        }
+        kernel.setDetectorDecimation(detectorDecimation);
+        kernel.setRecursiveDetectors(recursiveDetectors);
+        kernel.init(1, sampleRate);
+        kernel.reset();
+        for (size_t position = 0; position < audio.size(); position += 512) {
+            float* buffer = audio.data() + position;
+            kernel.setBuffers(&buffer, &buffer);
+            kernel.process(AUAudioFrameCount(std::min<size_t>(512, audio.size() - position)), 0);
+        }
+        return audio;
+    }
+
+    /*
+     The gain difference, in dB, of the given detectors from the full-rate
+     windowed ones over the samples where the full-rate output is above
+     -60 dBFS, sorted; empty if there are none.
+     */
+    std::vector<double> detectorDeviation(const IntensifierPreset& preset, double sampleRate, int detectorDecimation, bool recursiveDetectors)
+    {
+        std::vector<float> reference = renderPreset(preset, sampleRate, 1, false);
+        std::vector<float> approximated = renderPreset(preset, sampleRate, detectorDecimation, recursiveDetectors);
+        // The decimated modes delay the audio by one more group.
+        size_t latency = detectorDecimation > 1 ? size_t(detectorDecimation) : 0;
+        std::vector<double> deviation;
+        for (size_t frame = 0; frame + latency < reference.size(); ++frame) {
+            float expected = reference[frame];
+            float actual = approximated[frame + latency];
+            if (fabsf(expected) > 0.001f && actual != 0.0f) {
+                deviation.push_back(fabs(20.0 * log10(fabs(double(actual) / expected))));
+            }
+        }
+        std::sort(deviation.begin(), deviation.end());
+        return deviation;
+    }
+
+    void reportDeviation(const IntensifierPreset& preset, double sampleRate, int detectorDecimation, bool recursiveDetectors)
+    {
+        std::vector<double> sorted = detectorDeviation(preset, sampleRate, detectorDecimation, recursiveDetectors);
+        if (sorted.empty()) {
+            return;
+        }
+        size_t count = sorted.size();
+        printf("%s,%.0f,%d,%.4f,%.4f,%.4f,%.4f\n", preset.name, sampleRate, detectorDecimation, sorted[count - 1],
+               sorted[count * 999 / 1000], sorted[count * 99 / 100], sorted[count / 2]);
+        fflush(stdout);
+    }
+
+    enum CheckSignal {
+        kImpulses,
+        kBursts,
+        kSweep,
+        kSteppedNoise,
+        kCheckSignalCount
+    };
+    const char* const checkSignalNames[kCheckSignalCount] = { "impulses", "bursts", "sweep", "noise" };
+    const int kCheckChannels = 2;
+    // The other channel counts checked: mono, the generic path (3) and the 5.1 and 7.1 paths.
+    const int kCheckOtherChannelCounts[] = { 1, 3, 6, 8 };
+    const double kCheckSeconds = 2.0;
+    const int kCheckCycleFrames = 512;
+    // The silence skip check's signal, see makeGapSignal().
+    const double kGapSoundSeconds = 0.25;
+    const double kGapSeconds = 16.0;
+
+    /*
+     The 99th percentile deviations documented in
+     IntensifierDSPKernel::setDetectorDecimation() (the largest over the
+     factors) and setRecursiveDetectors(), in dB, by factory preset and by
+     sample rate: 44.1, 48, 96 and 192 kHz. --check allows kDeviationMarginDb
+     on top, for the documents' rounding and for compilers.
+     */
+    const double kCheckDeviationRates[4] = { 44100.0, 48000.0, 96000.0, 192000.0 };
+    const double kDecimatedDeviationDb[IntensifierFactoryPresetCount][4] = {
+        { 0.53, 0.70, 2.22, 3.12 },
+        { 0.83, 0.65, 0.93, 2.55 },
+        { 6.53, 6.52, 12.4, 27.0 }
+    };
+    const double kRecursiveDeviationDb[IntensifierFactoryPresetCount][4] = {
+        { 4.9, 4.6, 2.6, 1.9 },
+        { 13.1, 12.7, 12.2, 7.2 },
+        { 6.0, 25.6, 31.9, 16.0 }
+    };
+    const double kDeviationMarginDb = 0.5;
+
+    typedef std::vector<std::vector<float>> Audio;
+
+    // Deterministic check signal for one channel; the channels differ slightly so none is a copy of another.
+    std::vector<float> makeCheckSignal(CheckSignal signal, double sampleRate, int channel)
+    {
+        std::vector<float> samples(size_t(sampleRate * kCheckSeconds));
+        uint32_t seed = 0x2545F491u * uint32_t(channel + 1);
+        for (size_t frame = 0; frame < samples.size(); ++frame) {
+            seed = seed * 1664525u + 1013904223u;
+            float noise = float(int32_t(seed)) / 2147483648.0f;
+            double time = double(frame) / sampleRate;
+            switch (signal) {
+                case kImpulses: {
+                    // Full scale, alternating in sign, every quarter second.
+                    size_t period = size_t(sampleRate / 4);
+                    size_t offset = size_t(37 * channel);
+                    samples[frame] = frame % period == offset ? ((frame / period) % 2 ? -1.0f : 1.0f) : 0.0f;
+                    break;
+                }
+                case kBursts:
+                    // 50 ms of loud noise every 0.4 s, digital silence in between.
+                    samples[frame] = fmod(time, 0.4) < 0.05 ? 0.8f * noise : 0.0f;
+                    break;
+                case kSweep: {
+                    // Exponential sweep from 20 Hz to 20 kHz, or just below Nyquist.
+                    double endFrequency = std::min(20000.0, 0.45 * sampleRate);
+                    double rate = log(endFrequency / 20.0) / kCheckSeconds;
+                    double phase = 2.0 * M_PI * 20.0 * (exp(rate * time) - 1.0) / rate;
+                    samples[frame] = 0.5f * float(sin(phase + 0.5 * channel));
+                    break;
+                }
+                default: {
+                    // Noise stepping between levels 40 dB apart every quarter second.
+                    const float levels[] = { 0.5f, 0.05f, 0.25f, 0.005f };
+                    samples[frame] = levels[size_t(time * 4) % 4] * noise;
+                    break;
+                }
+            }
+        }
+        return samples;
+    }
+
+    // The check signal on channelCount channels, or channel 0's on all of them with identical set.
+    Audio makeCheckInput(CheckSignal signal, double sampleRate, int channelCount, bool identical)
+    {
+        Audio input;
+        for (int channel = 0; channel < channelCount; ++channel) {
+            input.push_back(makeCheckSignal(signal, sampleRate, identical ? 0 : channel));
+        }
+        return input;
+    }
+
+    /*
+     Loud noise for kGapSoundSeconds, kGapSeconds of digital silence, long
+     enough for every factory preset to settle, then the noise again.
+     */
+    std::vector<float> makeGapSignal(double sampleRate, int channel)
+    {
+        size_t soundFrames = size_t(sampleRate * kGapSoundSeconds);
+        std::vector<float> samples(2 * soundFrames + size_t(sampleRate * kGapSeconds));
+        uint32_t seed = 0x2545F491u * uint32_t(channel + 1);
+        for (size_t frame = 0; frame < samples.size(); ++frame) {
+            seed = seed * 1664525u + 1013904223u;
+            bool sounding = frame < soundFrames || frame >= samples.size() - soundFrames;
+            samples[frame] = sounding ? 0.8f * float(int32_t(seed)) / 2147483648.0f : 0.0f;
+        }
+        return samples;
+    }
+
+    /*
+     Host automation for the automation checks: ramps and immediate changes
+     of every parameter, one ramp cut short by another, all off the cycle
+     boundaries. Sorted by eventSampleTime, which is absolute.
+     */
+    std::vector<AURenderEvent> makeAutomation(double sampleRate)
+    {
+        struct Change {
+            double seconds;
+            int address;
+            AUValue value;
+            double rampSeconds;
+        };
+        const Change changes[] = {
+            { 0.30, IntensifierParamInputAmount, 6.0f, 0.2 },
+            { 0.40, IntensifierParamInputAmount, -3.0f, 0.1 },
+            { 0.55, IntensifierParamAttackAmount, 10.0f, 0.0 },
+            { 0.80, IntensifierParamReleaseAmount, -20.0f, 0.1 },
+            { 1.05, IntensifierParamAttackTime, 40.0f, 0.25 },
+            { 1.35, IntensifierParamReleaseTime, 0.2f, 0.0 },
+            { 1.60, IntensifierParamOutputAmount, -6.0f, 0.3 }
+        };
+        std::vector<AURenderEvent> events;
+        for (const Change& change : changes) {
+            AURenderEvent event = AURenderEvent();
+            event.parameter.eventSampleTime = AUEventSampleTime(change.seconds * sampleRate) + 7;
+            event.parameter.eventType = change.rampSeconds > 0.0 ? AURenderEventParameterRamp : AURenderEventParameter;
+            event.parameter.rampDurationSampleFrames = AUAudioFrameCount(change.rampSeconds * sampleRate);
+            event.parameter.parameterAddress = AUParameterAddress(change.address);
+            event.parameter.value = change.value;
+            events.push_back(event);
+        }
+        return events;
+    }
+
+    /*
+     Renders input with the reference, in cycles of kCheckCycleFrames split
+     at the automation's events, if any.
+     */
+    Audio renderReference(const IntensifierPreset& preset, double sampleRate, const Audio& input, const std::vector<AURenderEvent>* automation)
+    {
+        Audio output(input.size(), std::vector<float>(input[0].size()));
+        IntensifierReferenceKernel kernel;
+        kernel.init(int(input.size()), sampleRate, preset.values);
+        const float* inBuffers[IntensifierDSPKernel::kMaxChannels];
+        float* outBuffers[IntensifierDSPKernel::kMaxChannels];
+        size_t eventCount = automation != nullptr ? automation->size() : 0;
+        size_t nextEvent = 0;
+        for (size_t position = 0; position < input[0].size();) {
+            for (; nextEvent < eventCount && size_t((*automation)[nextEvent].parameter.eventSampleTime) <= position; ++nextEvent) {
+                const AUParameterEvent& event = (*automation)[nextEvent].parameter;
+                kernel.startRamp(int(event.parameterAddress), event.value, event.rampDurationSampleFrames);
+            }
+            size_t end = std::min(position - position % kCheckCycleFrames + kCheckCycleFrames, input[0].size());
+            if (nextEvent < eventCount) {
+                end = std::min(end, size_t((*automation)[nextEvent].parameter.eventSampleTime));
+            }
+            for (size_t channel = 0; channel < input.size(); ++channel) {
+                inBuffers[channel] = input[channel].data() + position;
+                outBuffers[channel] = output[channel].data() + position;
+            }
+            kernel.process(inBuffers, outBuffers, int(end - position));
+            position = end;
+        }
+        return output;
+    }
+
+    // How renderKernel() sets up the kernel.
+    struct KernelSetup {
+        int detectorDecimation = 1;
+        bool recursiveDetectors = false;
+        IntensifierDSPKernel::DetectorLink detectorLink = IntensifierDSPKernel::kDetectorLinkOff;
+        bool schedulesParameterEvents = true;
+        // Host automation, see makeAutomation(); each event goes with the cycle it falls in.
+        const std::vector<AURenderEvent>* automation = nullptr;
+    };
+
+    /*
+     Renders input with the kernel through processWithEvents, in cycles of
+     kCheckCycleFrames or, with randomSeed set, of random lengths from 1 to
+     4096 frames.
+     */
+    Audio renderKernel(const IntensifierPreset& preset, double sampleRate, const Audio& input, const KernelSetup& setup, uint32_t randomSeed)
+    {
+        Audio output(input.size(), std::vector<float>(input[0].size()));
+        IntensifierDSPKernel kernel;
+        for (int address = 0; address < 6; ++address) {
+            kernel.setParameter(address, preset.values[address]);
+        }
+        kernel.setMaximumFramesToRender(4096);
+        kernel.setDetectorDecimation(setup.detectorDecimation);
+        kernel.setRecursiveDetectors(setup.recursiveDetectors);
+        kernel.setDetectorLink(setup.detectorLink);
+        kernel.setSchedulesParameterEvents(setup.schedulesParameterEvents);
+        kernel.init(int(input.size()), sampleRate);
+        kernel.reset();
+        const float* inBuffers[IntensifierDSPKernel::kMaxChannels];
+        float* outBuffers[IntensifierDSPKernel::kMaxChannels];
+        size_t eventCount = setup.automation != nullptr ? setup.automation->size() : 0;
+        size_t nextEvent = 0;
+        std::vector<AURenderEvent> cycleEvents;
+        uint32_t seed = randomSeed;
+        for (size_t position = 0; position < input[0].size();) {
+            size_t cycleFrames = kCheckCycleFrames;
+            if (randomSeed != 0) {
+                seed = seed * 1664525u + 1013904223u;
+                cycleFrames = 1 + (seed >> 8) % 4096;
+            }
+            cycleFrames = std::min(cycleFrames, input[0].size() - position);
+            for (size_t channel = 0; channel < input.size(); ++channel) {
+                inBuffers[channel] = input[channel].data() + position;
+                outBuffers[channel] = output[channel].data() + position;
+            }
+            cycleEvents.clear();
+            for (; nextEvent < eventCount && size_t((*setup.automation)[nextEvent].head.eventSampleTime) < position + cycleFrames; ++nextEvent) {
+                cycleEvents.push_back((*setup.automation)[nextEvent]);
+            }
+            for (size_t index = 0; index < cycleEvents.size(); ++index) {
+                cycleEvents[index].head.next = index + 1 < cycleEvents.size() ? &cycleEvents[index + 1] : nullptr;
+            }
+            kernel.setBuffers(inBuffers, outBuffers);
+            AudioTimeStamp timestamp = {};
+            timestamp.mSampleTime = double(position);
+            kernel.processWithEvents(&timestamp, AUAudioFrameCount(cycleFrames), cycleEvents.empty() ? nullptr : cycleEvents.data(), nullptr);
+            position += cycleFrames;
+        }
+        return output;
+    }
+
+    Audio renderBatch(const IntensifierPreset& preset, double sampleRate, const Audio& input)
+    {
+        Audio output(input.size(), std::vector<float>(input[0].size()));
+        IntensifierBatchKernel batch;
+        batch.init(1, int(input.size()), sampleRate);
+        int id = batch.addInstance(int(input.size()), preset.values);
+        batch.applyPendingChanges();
+        const float* inBuffers[IntensifierDSPKernel::kMaxChannels];
+        float* outBuffers[IntensifierDSPKernel::kMaxChannels];
+        for (size_t position = 0; position < input[0].size(); position += kCheckCycleFrames) {
+            size_t frameCount = std::min<size_t>(kCheckCycleFrames, input[0].size() - position);
+            for (size_t channel = 0; channel < input.size(); ++channel) {
+                inBuffers[channel] = input[channel].data() + position;
+                outBuffers[channel] = output[channel].data() + position;
+            }
+            batch.setBuffers(id, inBuffers, outBuffers);
+            batch.process(AUAudioFrameCount(frameCount));
+        }
+        return output;
+    }
+
+    // Per-sample differences between actual and expected relative to the peak of expected, sorted.
+    std::vector<double> relativeErrors(const Audio& actual, const Audio& expected)
+    {
+        double peak = 0.0;
+        for (const std::vector<float>& channel : expected) {
+            for (float sample : channel) {
+                peak = std::max(peak, fabs(double(sample)));
+            }
+        }
+        double scale = peak > 0.0 ? 1.0 / peak : 1.0;
+        std::vector<double> errors;
+        for (size_t channel = 0; channel < expected.size(); ++channel) {
+            for (size_t frame = 0; frame < expected[channel].size(); ++frame) {
+                double difference = fabs(double(actual[channel][frame]) - double(expected[channel][frame]));
+                // NaN in the output is as wrong as it gets.
+                errors.push_back(difference == difference ? difference * scale : INFINITY);
+            }
+        }
+        std::sort(errors.begin(), errors.end());
+        return errors;
+    }
+
+    struct CheckReport {
+        std::map<std::string, double> baseline; // speed values of an earlier run, by row key
+        int failures = 0;
+        // Sum of the logs of each speed row's kernel-to-reference ratio over the baseline's, and their count.
+        double baselineLogRatios = 0.0;
+        int baselineRows = 0;
+    };
+
+    std::string checkKey(const char* check, const std::string& path, const char* signal, const char* preset, double sampleRate)
+    {
+        char key[256];
+        snprintf(key, sizeof(key), "%s,%s,%s,%s,%.0f", check, path.c_str(), signal, preset, sampleRate);
+        return key;
+    }
+
+    // Prints a row; a negative limit is informational and cannot fail.
+    void reportCheck(CheckReport& report, const std::string& key, double value, double limit)
+    {
+        const char* result = "info";
+        if (limit >= 0.0) {
+            bool passed = value <= limit;
+            result = passed ? "pass" : "FAIL";
+            report.failures += passed ? 0 : 1;
+        }
+        std::string limitText = limit >= 0.0 ? std::to_string(limit) : std::string();
+        printf("%s,%.6g,%s,%s\n", key.c_str(), value, limitText.c_str(), result);
+        fflush(stdout);
+    }
+
+    // Reads the speed rows of an earlier --check run.
+    bool readBaseline(const std::string& path, CheckReport& report)
+    {
+        std::ifstream stream(path);
+        if (!stream) {
+            return false;
+        }
+        std::string line;
+        while (std::getline(stream, line)) {
+            if (line.compare(0, 6, "speed,") != 0) {
+                continue;
+            }
+            // The key is the first five fields, the value the sixth.
+            size_t end = 0;
+            for (int field = 0; field < 5 && end != std::string::npos; ++field) {
+                end = line.find(',', end + 1);
+            }
+            if (end != std::string::npos) {
+                report.baseline[line.substr(0, end)] = atof(line.c_str() + end + 1);
+            }
+        }
+        return true;
+    }
+
+    // Seconds of the fastest of at least three calls to render, repeated for at least minSeconds; robust to noisy machines.
+    template <typename Render>
+    double fastestRender(const BenchmarkOptions& options, Render render)
+    {
+        double fastest = INFINITY;
+        double total = 0.0;
+        for (int run = 0; run < 3 || total < options.minSeconds; ++run) {
+            auto start = std::chrono::steady_clock::now();
+            render();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            fastest = std::min(fastest, seconds);
+            total += seconds;
+        }
+        return fastest;
+    }
+
+    // accuracy and accuracy-max rows for one render against the reference's.
+    void checkAccuracy(const BenchmarkOptions& options, CheckReport& report, const std::string& path, const char* signal, const IntensifierPreset& preset, double sampleRate, const Audio& actual, const Audio& reference)
+    {
+        std::vector<double> errors = relativeErrors(actual, reference);
+        reportCheck(report, checkKey("accuracy", path, signal, preset.name, sampleRate), errors[errors.size() * 99 / 100], options.tolerance);
+        reportCheck(report, checkKey("accuracy-max", path, signal, preset.name, sampleRate), errors.back(), options.maxTolerance);
+    }
+
+    // A blocks row: the kernel rendered with setup in cycles of random lengths against expected, its render in kCheckCycleFrames cycles.
+    void checkBlocks(CheckReport& report, const std::string& path, const char* signal, const IntensifierPreset& preset, double sampleRate, const Audio& input, const KernelSetup& setup, const Audio& expected)
+    {
+        double blockDifference = 0.0;
+        for (uint32_t seed = 1; seed <= 3; ++seed) {
+            blockDifference = std::max(blockDifference, relativeErrors(renderKernel(preset, sampleRate, input, setup, seed), expected).back());
+        }
+        reportCheck(report, checkKey("blocks", path, signal, preset.name, sampleRate), blockDifference, 0.0);
+    }
+
+    // A path name with the channel count appended, as in kernel-6ch.
+    std::string channelPath(const char* path, int channelCount)
+    {
+        return std::string(path) + "-" + std::to_string(channelCount) + "ch";
+    }
+
+    void checkPreset(const BenchmarkOptions& options, CheckReport& report, CheckSignal signal, const IntensifierPreset& preset, double sampleRate)
+    {
+        Audio input = makeCheckInput(signal, sampleRate, kCheckChannels, false);
+        const char* signalName = checkSignalNames[signal];
+        Audio reference = renderReference(preset, sampleRate, input, nullptr);
+        Audio kernel = renderKernel(preset, sampleRate, input, KernelSetup(), 0);
+        checkAccuracy(options, report, "kernel", signalName, preset, sampleRate, kernel, reference);
+        checkAccuracy(options, report, "batch", signalName, preset, sampleRate, renderBatch(preset, sampleRate, input), reference);
+        checkBlocks(report, "kernel", signalName, preset, sampleRate, input, KernelSetup(), kernel);
+
+        double samples = double(input[0].size() * kCheckChannels);
+        double referenceNs = fastestRender(options, [&]() { sink = renderReference(preset, sampleRate, input, nullptr)[0][0]; }) * 1e9 / samples;
+        double kernelNs = fastestRender(options, [&]() { sink = renderKernel(preset, sampleRate, input, KernelSetup(), 0)[0][0]; }) * 1e9 / samples;
+        std::string referenceKey = checkKey("speed", "reference", signalName, preset.name, sampleRate);
+        std::string kernelKey = checkKey("speed", "kernel", signalName, preset.name, sampleRate);
+        reportCheck(report, referenceKey, referenceNs, -1.0);
+        reportCheck(report, kernelKey, kernelNs, referenceNs);
+        auto baselineReference = report.baseline.find(referenceKey);
+        auto baselineKernel = report.baseline.find(kernelKey);
+        if (baselineReference != report.baseline.end() && baselineKernel != report.baseline.end()) {
+            report.baselineLogRatios += log((kernelNs / referenceNs) / (baselineKernel->second / baselineReference->second));
+            ++report.baselineRows;
+        }
+    }
+
+    /*
+     The speed-baseline row: the geometric mean over the speed rows of the
+     kernel's ns_per_sample relative to the reference's, as a multiple of the
+     same in the baseline. Relative to the reference, so a baseline from
+     another machine still applies; averaged, because single rows of a short
+     render vary by tens of percent from run to run on a busy machine.
+     */
+    void checkBaseline(const BenchmarkOptions& options, CheckReport& report)
+    {
+        if (report.baseline.empty()) {
+            return;
+        }
+        if (report.baselineRows == 0) {
+            fprintf(stderr, "%s has no speed rows for these cases\n", options.baselinePath.c_str());
+            ++report.failures;
+            return;
+        }
+        double slowdown = exp(report.baselineLogRatios / report.baselineRows);
+        char key[64];
+        snprintf(key, sizeof(key), "speed-baseline,kernel,all,all,%d", report.baselineRows);
+        reportCheck(report, key, slowdown, options.maxSlowdown);
+    }
+
+    // The mono, generic, 5.1 and 7.1 render paths of the kernel and the batch against the reference.
+    void checkChannelCounts(const BenchmarkOptions& options, CheckReport& report, CheckSignal signal, const IntensifierPreset& preset, double sampleRate)
+    {
+        const char* signalName = checkSignalNames[signal];
+        for (int channelCount : kCheckOtherChannelCounts) {
+            Audio input = makeCheckInput(signal, sampleRate, channelCount, false);
+            Audio reference = renderReference(preset, sampleRate, input, nullptr);
+            Audio kernel = renderKernel(preset, sampleRate, input, KernelSetup(), 0);
+            checkAccuracy(options, report, channelPath("kernel", channelCount), signalName, preset, sampleRate, kernel, reference);
+            checkAccuracy(options, report, channelPath("batch", channelCount), signalName, preset, sampleRate, renderBatch(preset, sampleRate, input), reference);
+            checkBlocks(report, channelPath("kernel", channelCount), signalName, preset, sampleRate, input, KernelSetup(), kernel);
+        }
+    }
+
+    /*
+     Sample-accurate automation (see makeAutomation()) against the reference
+     ramped at the same frames, with the events scheduled into one pass
+     (kernel-automation) and splitting the cycle (kernel-automation-split).
+     The kernel re-evaluates ramping slide times every controlRateFrames
+     from the start of each cycle, so the blocks row leaves out the time
+     ramps; the gains ramp per frame and must not depend on the cycles.
+     */
+    void checkAutomation(const BenchmarkOptions& options, CheckReport& report, CheckSignal signal, const IntensifierPreset& preset, double sampleRate)
+    {
+        const char* signalName = checkSignalNames[signal];
+        std::vector<AURenderEvent> automation = makeAutomation(sampleRate);
+        Audio input = makeCheckInput(signal, sampleRate, kCheckChannels, false);
+        Audio reference = renderReference(preset, sampleRate, input, &automation);
+        KernelSetup setup;
+        setup.automation = &automation;
+        Audio kernel = renderKernel(preset, sampleRate, input, setup, 0);
+        checkAccuracy(options, report, "kernel-automation", signalName, preset, sampleRate, kernel, reference);
+        std::vector<AURenderEvent> gainAutomation;
+        for (const AURenderEvent& event : automation) {
+            bool timeRamp = event.parameter.eventType == AURenderEventParameterRamp &&
+                (event.parameter.parameterAddress == IntensifierParamAttackTime || event.parameter.parameterAddress == IntensifierParamReleaseTime);
+            if (!timeRamp) {
+                gainAutomation.push_back(event);
+            }
+        }
+        setup.automation = &gainAutomation;
+        checkBlocks(report, "kernel-automation", signalName, preset, sampleRate, input, setup, renderKernel(preset, sampleRate, input, setup, 0));
+        setup.automation = &automation;
+        setup.schedulesParameterEvents = false;
+        checkAccuracy(options, report, "kernel-automation-split", signalName, preset, sampleRate, renderKernel(preset, sampleRate, input, setup, 0), reference);
+    }
+
+    /*
+     The linked detectors, on a copy of one channel on every channel: the
+     loudest channel, the average power and the mid are then all that
+     channel, so the linked render must match the unlinked reference's.
+     */
+    void checkLinkedDetectors(const BenchmarkOptions& options, CheckReport& report, CheckSignal signal, const IntensifierPreset& preset, double sampleRate)
+    {
+        const char* signalName = checkSignalNames[signal];
+        const char* const linkNames[] = { "kernel-max", "kernel-average", "kernel-mid" };
+        const IntensifierDSPKernel::DetectorLink links[] = {
+            IntensifierDSPKernel::kDetectorLinkMax, IntensifierDSPKernel::kDetectorLinkAverage, IntensifierDSPKernel::kDetectorLinkMid
+        };
+        for (int channelCount : { kCheckChannels, 6 }) {
+            Audio input = makeCheckInput(signal, sampleRate, channelCount, true);
+            Audio reference = renderReference(preset, sampleRate, input, nullptr);
+            for (int link = 0; link < 3; ++link) {
+                KernelSetup setup;
+                setup.detectorLink = links[link];
+                Audio kernel = renderKernel(preset, sampleRate, input, setup, 0);
+                std::string path = channelCount == kCheckChannels ? std::string(linkNames[link]) : channelPath(linkNames[link], channelCount);
+                checkAccuracy(options, report, path, signalName, preset, sampleRate, kernel, reference);
+                checkBlocks(report, path, signalName, preset, sampleRate, input, setup, kernel);
+            }
+        }
+    }
+
+    /*
+     The decimated and recursive detectors, which approximate the reference
+     (see checkDeviation()), must still render the same in any cycle
+     lengths, alone and together with linked detectors.
+     */
+    void checkApproximateDetectorBlocks(CheckReport& report, CheckSignal signal, const IntensifierPreset& preset, double sampleRate)
+    {
+        const char* signalName = checkSignalNames[signal];
+        Audio input = makeCheckInput(signal, sampleRate, kCheckChannels, false);
+        KernelSetup setups[3];
+        setups[0].detectorDecimation = 8;
+        setups[1].recursiveDetectors = true;
+        setups[2].detectorDecimation = 8;
+        setups[2].recursiveDetectors = true;
+        setups[2].detectorLink = IntensifierDSPKernel::kDetectorLinkMax;
+        const char* const paths[] = { "kernel-decimated8", "kernel-recursive", "kernel-max-decimated8-recursive" };
+        for (int setup = 0; setup < 3; ++setup) {
+            Audio kernel = renderKernel(preset, sampleRate, input, setups[setup], 0);
+            checkBlocks(report, paths[setup], signalName, preset, sampleRate, input, setups[setup], kernel);
+        }
+    }
+
+    /*
+     deviation rows: the 99th percentile gain difference, in dB, of the
+     decimated detectors at each factor and of the recursive ones from the
+     full-rate windowed detectors, as --deviation measures it, against the
+     documented figures.
+     */
+    void checkDeviation(CheckReport& report, int presetIndex, double sampleRate)
+    {
+        const IntensifierPreset& preset = IntensifierFactoryPresets[presetIndex];
+        int rateIndex = int(std::find(kCheckDeviationRates, kCheckDeviationRates + 4, sampleRate) - kCheckDeviationRates);
+        if (rateIndex == 4) {
+            return;
+        }
+        for (int decimation = 1; decimation <= IntensifierDSPKernel::kMaxDetectorDecimation; decimation *= 2) {
+            bool recursive = decimation == 1;
+            std::vector<double> sorted = detectorDeviation(preset, sampleRate, decimation, recursive);
+            double p99 = sorted.empty() ? 0.0 : sorted[sorted.size() * 99 / 100];
+            double documented = recursive ? kRecursiveDeviationDb[presetIndex][rateIndex] : kDecimatedDeviationDb[presetIndex][rateIndex];
+            std::string path = recursive ? std::string("recursive") : "decimated" + std::to_string(decimation);
+            reportCheck(report, checkKey("deviation", path, "tone-bursts", preset.name, sampleRate), p99, documented + kDeviationMarginDb);
+        }
+    }
+
+    /*
+     Renders the gap signal (see makeGapSignal()) in kCheckCycleFrames
+     cycles. The kernel must match the reference throughout, must skip the
+     settled silence before the sound returns, flagging it silent, and must
+     never flag a cycle that sounds.
+     */
+    void checkSilenceSkip(const BenchmarkOptions& options, CheckReport& report, const IntensifierPreset& preset, double sampleRate)
+    {
+        Audio input;
+        for (int channel = 0; channel < kCheckChannels; ++channel) {
+            input.push_back(makeGapSignal(sampleRate, channel));
+        }
+        size_t silenceStart = size_t(sampleRate * kGapSoundSeconds);
+        Audio reference = renderReference(preset, sampleRate, input, nullptr);
+        IntensifierDSPKernel kernel;
+        for (int address = 0; address < 6; ++address) {
+            kernel.setParameter(address, preset.values[address]);
+        }
+        kernel.init(kCheckChannels, sampleRate);
+        kernel.reset();
+        Audio output(input.size(), std::vector<float>(input[0].size()));
+        const float* inBuffers[kCheckChannels];
+        float* outBuffers[kCheckChannels];
+        double skipSeconds = INFINITY;
+        int wronglySilent = 0;
+        for (size_t position = 0; position < input[0].size(); position += kCheckCycleFrames) {
+            size_t frameCount = std::min<size_t>(kCheckCycleFrames, input[0].size() - position);
+            for (size_t channel = 0; channel < input.size(); ++channel) {
+                inBuffers[channel] = input[channel].data() + position;
+                outBuffers[channel] = output[channel].data() + position;
+            }
+            kernel.setBuffers(inBuffers, outBuffers);
+            AudioTimeStamp timestamp = {};
+            timestamp.mSampleTime = double(position);
+            kernel.processWithEvents(&timestamp, AUAudioFrameCount(frameCount), nullptr, nullptr);
+            bool sounding = false;
+            for (size_t channel = 0; channel < input.size(); ++channel) {
+                for (size_t frame = 0; frame < frameCount; ++frame) {
+                    sounding |= outBuffers[channel][frame] != 0.0f;
+                }
+            }
+            bool flagged = kernel.takeOutputIsSilence();
+            wronglySilent += flagged && sounding ? 1 : 0;
+            if (flagged && position >= silenceStart && skipSeconds == INFINITY) {
+                skipSeconds = double(position - silenceStart) / sampleRate;
+            }
+        }
+        checkAccuracy(options, report, "kernel", "gap", preset, sampleRate, output, reference);
+        reportCheck(report, checkKey("silence-skip", "kernel", "gap", preset.name, sampleRate), skipSeconds, kGapSeconds);
+        reportCheck(report, checkKey("silence-flag", "kernel", "gap", preset.name, sampleRate), wronglySilent, 0.0);
+    }
+
+    /*
+     Renders input bypassed, in kCheckCycleFrames cycles, and counts the
+     cycles that takeOutputIsSilence() flags silent although they passed
+     sound through. There must be none: hosts may drop flagged output.
+     */
+    void checkBypassSilenceFlag(CheckReport& report, const IntensifierPreset& preset, double sampleRate)
+    {
+        Audio input = makeCheckInput(kBursts, sampleRate, kCheckChannels, false);
+        IntensifierDSPKernel kernel;
+        for (int address = 0; address < 6; ++address) {
+            kernel.setParameter(address, preset.values[address]);
+        }
+        kernel.init(kCheckChannels, sampleRate);
+        kernel.reset();
+        kernel.setBypass(true);
+        Audio output(input.size(), std::vector<float>(input[0].size()));
+        const float* inBuffers[kCheckChannels];
+        float* outBuffers[kCheckChannels];
+        int wronglySilent = 0;
+        for (size_t position = 0; position < input[0].size(); position += kCheckCycleFrames) {
+            size_t frameCount = std::min<size_t>(kCheckCycleFrames, input[0].size() - position);
+            bool sounding = false;
+            for (size_t channel = 0; channel < input.size(); ++channel) {
+                inBuffers[channel] = input[channel].data() + position;
+                outBuffers[channel] = output[channel].data() + position;
+            }
+            kernel.setBuffers(inBuffers, outBuffers);
+            AudioTimeStamp timestamp = {};
+            timestamp.mSampleTime = double(position);
+            kernel.processWithEvents(&timestamp, AUAudioFrameCount(frameCount), nullptr, nullptr);
+            for (size_t channel = 0; channel < input.size(); ++channel) {
+                for (size_t frame = 0; frame < frameCount; ++frame) {
+                    sounding |= outBuffers[channel][frame] != 0.0f;
+                }
+            }
+            wronglySilent += kernel.takeOutputIsSilence() && sounding ? 1 : 0;
+        }
+        reportCheck(report, checkKey("silence-flag", "bypass", checkSignalNames[kBursts], preset.name, sampleRate), wronglySilent, 0.0);
+    }
+
+    bool parseDetectorLink(const std::string& name, IntensifierDSPKernel::DetectorLink& link)
+    {
+        const char* const names[] = { "off", "max", "average", "mid" };
+        for (int mode = 0; mode < 4; ++mode) {
+            if (name == names[mode]) {
+                link = IntensifierDSPKernel::DetectorLink(mode);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void printUsage()
+    {
+        fprintf(stderr,
+                "usage: intensifier-bench [options]\n"
+                "  --min-time S     minimum measured time per case (default 0.1)\n"
+                "  --filter TEXT    only run benchmarks whose name contains TEXT\n"
+                "  --quick          run a reduced grid of cases\n"
+                "  --detector-decimation N\n"
+                "                   run the kernel cases with decimated detectors\n"
+                "  --recursive-detectors\n"
+                "                   run the kernel cases with recursive RMS detectors\n"
+                "  --detector-link MODE\n"
+                "                   run the kernel cases with linked detectors: off,\n"
+                "                   max, average or mid\n"
+                "  --deviation      report the decimated detectors' deviation instead,\n"
+                "                   or the recursive ones' with --recursive-detectors\n"
+                "  --check          compare the optimized kernels with the reference\n"
+                "                   kernel instead; exits with 1 on any failure\n"
+                "  --tolerance X    99th percentile difference from the reference,\n"
+                "                   relative to its peak, that --check accepts (default 1e-3)\n"
+                "  --max-tolerance X\n"
+                "                   largest such difference accepted (default 0.01)\n"
+                "  --baseline FILE  --check output of an earlier run to compare speed with\n"
+                "                   (default: the committed Tools/check-baseline.csv)\n"
+                "  --no-baseline    only compare speed with the reference kernel\n"
+                "  --max-slowdown R slowest kernel accepted relative to the reference, as\n"
+                "                   a multiple of the baseline's, averaged (default 1.25)\n");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--quick") {
+            options.quick = true;
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            options.minSeconds = atof(argv[++i]);
+        } else if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (arg == "--detector-decimation" && i + 1 < argc) {
+            options.detectorDecimation = atoi(argv[++i]);
+        } else if (arg == "--recursive-detectors") {
+            options.recursiveDetectors = true;
+        } else if (arg == "--detector-link" && i + 1 < argc && parseDetectorLink(argv[i + 1], options.detectorLink)) {
+            ++i;
+        } else if (arg == "--deviation") {
+            options.deviation = true;
+        } else if (arg == "--check") {
+            options.check = true;
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            options.tolerance = atof(argv[++i]);
+        } else if (arg == "--max-tolerance" && i + 1 < argc) {
+            options.maxTolerance = atof(argv[++i]);
+        } else if (arg == "--baseline" && i + 1 < argc) {
+            options.baselinePath = argv[++i];
+        } else if (arg == "--no-baseline") {
+            options.baselinePath.clear();
+        } else if (arg == "--max-slowdown" && i + 1 < argc) {
+            options.maxSlowdown = atof(argv[++i]);
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    std::vector<double> sampleRates = {44100.0, 48000.0, 96000.0, 192000.0};
+    std::vector<int> channelCounts = {1, 2, 6, 8};
+    std::vector<int> blockSizes = {16, 32, 64, 128, 256, 512, 1024, 2048, 4096};
+    std::vector<int> instanceCounts = {8, 32, 128};
+    std::vector<int> sessionBlockSizes = {64, 512};
+    if (options.quick) {
+        sampleRates = {44100.0, 192000.0};
+        channelCounts = {1, 2};
+        blockSizes = {16, 128, 1024, 4096};
+        instanceCounts = {32};
+        sessionBlockSizes = {512};
+    }
+
+    if (options.deviation) {
+        printf("preset,sample_rate,detector_decimation,max_db,p999_db,p99_db,median_db\n");
+        for (double sampleRate : sampleRates) {
+            for (int preset = 0; preset < IntensifierFactoryPresetCount; ++preset) {
+                int firstDecimation = options.recursiveDetectors ? 1 : 2;
+                for (int decimation = firstDecimation; decimation <= IntensifierDSPKernel::kMaxDetectorDecimation; decimation *= 2) {
+                    reportDeviation(IntensifierFactoryPresets[preset], sampleRate, decimation, options.recursiveDetectors);
+                }
+            }
+        }
+        return 0;
+    }
+
+    if (options.check) {
+        CheckReport report;
+        if (!options.baselinePath.empty() && !readBaseline(options.baselinePath, report)) {
+            fprintf(stderr, "cannot read %s; pass --no-baseline to check without one\n", options.baselinePath.c_str());
+            return 2;
+        }
+        printf("check,path,signal,preset,sample_rate,value,limit,result\n");
+        for (double sampleRate : sampleRates) {
+            for (int signal = 0; signal < kCheckSignalCount; ++signal) {
+                for (int preset = 0; preset < IntensifierFactoryPresetCount; ++preset) {
+                    const IntensifierPreset& factoryPreset = IntensifierFactoryPresets[preset];
+                    checkPreset(options, report, CheckSignal(signal), factoryPreset, sampleRate);
+                    checkChannelCounts(options, report, CheckSignal(signal), factoryPreset, sampleRate);
+                    checkAutomation(options, report, CheckSignal(signal), factoryPreset, sampleRate);
+                    checkLinkedDetectors(options, report, CheckSignal(signal), factoryPreset, sampleRate);
+                    checkApproximateDetectorBlocks(report, CheckSignal(signal), factoryPreset, sampleRate);
+                }
+            }
+            for (int preset = 0; preset < IntensifierFactoryPresetCount; ++preset) {
+                checkDeviation(report, preset, sampleRate);
+                checkSilenceSkip(options, report, IntensifierFactoryPresets[preset], sampleRate);
+            }
+            checkBypassSilenceFlag(report, IntensifierFactoryPresets[0], sampleRate);
+        }
+        checkBaseline(options, report);
+        if (report.failures > 0) {
+            fprintf(stderr, "%d checks failed\n", report.failures);
+            return 1;
+        }
+        return 0;
+    }
+
+    printf("benchmark,sample_rate,channels,block_frames,parameters,detector_decimation,frames,seconds,ns_per_sample,realtime_factor\n");
+    for (double sampleRate : sampleRates) {
+        if (selected(options, "rmsaverage.push")) {
+            benchmarkRMSAverage(options, sampleRate);
+        }
+        if (selected(options, "rmsaverage.process")) {
+            for (int blockFrames : blockSizes) {
+                benchmarkRMSAverageBlock(options, sampleRate, blockFrames);
+            }
+        }
+        if (selected(options, "slide.push")) {
+            benchmarkSlide(options, sampleRate);
+        }
+        if (selected(options, "delay.push")) {
+            benchmarkDelay(options, sampleRate);
+        }
+        if (selected(options, "lookahead.process")) {
+            for (int blockFrames : blockSizes) {
+                benchmarkLookahead(options, sampleRate, blockFrames);
+            }
+        }
+    }
+    if (selected(options, "kernel.process")) {
+        for (double sampleRate : sampleRates) {
+            for (int channelCount : channelCounts) {
+                for (int blockFrames : blockSizes) {
+                    benchmarkKernel(options, sampleRate, channelCount, blockFrames, kStaticParameters);
+                    benchmarkKernel(options, sampleRate, channelCount, blockFrames, kRampingParameters);
+                    benchmarkKernel(options, sampleRate, channelCount, blockFrames, kSilentInput);
+                    benchmarkKernel(options, sampleRate, channelCount, blockFrames, kDecayingTail);
+                    benchmarkKernel(options, sampleRate, channelCount, blockFrames, kDecayingTailWithDenormals);
+                }
+            }
+        }
+    }
+    if (selected(options, "kernel.events")) {
+        for (double sampleRate : sampleRates) {
+            for (int blockFrames : sessionBlockSizes) {
+                for (int dense = 0; dense < 2; ++dense) {
+                    benchmarkEvents(options, sampleRate, blockFrames, dense, false);
+                    benchmarkEvents(options, sampleRate, blockFrames, dense, true);
+                }
+            }
+        }
+    }
+    for (double sampleRate : sampleRates) {
+        for (int instanceCount : instanceCounts) {
+            for (int blockFrames : sessionBlockSizes) {
+                if (selected(options, "instances.process")) {
+                    benchmarkSession(options, sampleRate, instanceCount, blockFrames, false);
+                }
+                if (selected(options, "batch.process")) {
+                    benchmarkSession(options, sampleRate, instanceCount, blockFrames, true);
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,765 @@
+/*
+ intensifier-render
+ Offline batch renderer. Runs every WAV file from a directory or manifest
+ through IntensifierDSPKernel with a factory preset or explicit parameter
+ values, and writes 32 bit float WAV files with the same names to the
+ output directory.
+
+ The work is a TaskGraph run by a WorkStealingExecutor. Each file is read,
+ split into groups of channels with a kernel each, rendered a range of
+ blocks at a time, one task per range, and written. A group's ranges run
+ in order, so the output only depends on the block size, channel grouping
+ and task size, never on the thread count. With linked detectors a file's
+ channels stay in one group.
+
+ With --stream, each file is one task that streams it from disk to disk
+ instead, see streamFile(), so arbitrarily long files render in constant
+ memory. The output is the same either way.
+ */
+#include "IntensifierDSPKernel.hpp"
+#include "IntensifierPresets.hpp"
+#include "TaskGraph.hpp"
+#include "WavFile.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <dirent.h>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct RenderOptions {
+        std::vector<std::string> inputs;
+        std::string manifest;
+        std::string outputDirectory;
+        std::string statsPath;
+        AUValue parameters[6];
+        int threadCount = 0;
+        int blockSize = 512;
+        int channelsPerTask = 0; // 0: all of a file's channels
+        int taskFrames = 262144;
+        int chunkFrames = 65536;
+        int detectorDecimation = 1;
+        bool recursiveDetectors = false;
+        IntensifierDSPKernel::DetectorLink detectorLink = IntensifierDSPKernel::kDetectorLinkOff;
+        bool stream = false;
+        bool quiet = false;
+    };
+
+    struct RenderJob {
+        std::string inputPath;
+        std::string outputPath;
+        // Filled in by the tasks. error is set by the first one to fail; the rest then skip.
+        bool succeeded = false;
+        std::string error;
+        int channelCount = 0;
+        uint64_t frameCount = 0;
+        double sampleRate = 0.0;
+        std::vector<std::vector<float>> audio; // rendered in place
+        std::vector<std::unique_ptr<IntensifierDSPKernel>> kernels; // one per channel group
+    };
+
+    void printUsage()
+    {
+        fprintf(stderr,
+                "usage: intensifier-render -o DIR [options] (DIR | FILE.wav)...\n"
+                "  -o, --output DIR      directory for the rendered files\n"
+                "  -m, --manifest FILE   read input paths from FILE, one per line\n"
+                "  -p, --preset NAME|N   factory preset (default Subtle)\n"
+                "  --inputAmount DB, --attackAmount DB, --releaseAmount DB,\n"
+                "  --attackTime MS, --releaseTime S, --outputAmount DB\n"
+                "                        override a single parameter\n"
+                "  -j, --threads N       worker threads (default: all cores)\n"
+                "  -b, --block-size N    frames per process call (default 512)\n"
+                "  --channels-per-task N render each group of N channels of a file with\n"
+                "                        its own kernel, in parallel (default: all);\n"
+                "                        ignored with --detector-link\n"
+                "  --task-frames N       frames rendered per task, rounded up to whole\n"
+                "                        blocks (default 262144)\n"
+                "  --stream              stream each file from disk to disk in constant\n"
+                "                        memory, overlapping reading and writing with\n"
+                "                        rendering, instead of loading it whole\n"
+                "  --chunk-frames N      frames per streamed chunk, rounded up to whole\n"
+                "                        blocks (default 65536)\n"
+                "  --detector-decimation N\n"
+                "                        run the detectors every N frames (default 1);\n"
+                "                        approximate, up to 27 dB off at 192 kHz, see\n"
+                "                        IntensifierDSPKernel::setDetectorDecimation()\n"
+                "  --recursive-detectors use buffer-free recursive RMS detectors instead\n"
+                "                        of moving windows; approximate, up to 32 dB off,\n"
+                "                        see IntensifierDSPKernel::setRecursiveDetectors()\n"
+                "  --detector-link MODE  link the channels' detectors: off (default), max,\n"
+                "                        average or mid\n"
+                "  --stats FILE          write render timing counters to FILE as CSV\n"
+                "                        (needs a build with INTENSIFIER_RENDER_STATS=ON)\n"
+                "  -q, --quiet           only print the summary\n"
+                "presets:");
+        for (int i = 0; i < IntensifierFactoryPresetCount; ++i) {
+            fprintf(stderr, " %d \"%s\"", i, IntensifierFactoryPresets[i].name);
+        }
+        fprintf(stderr, "\n");
+    }
+
+    bool isDirectory(const std::string& path)
+    {
+        struct stat info;
+        return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+    }
+
+    bool hasWavExtension(const std::string& name)
+    {
+        if (name.size() < 4) {
+            return false;
+        }
+        std::string extension = name.substr(name.size() - 4);
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        return extension == ".wav";
+    }
+
+    std::string fileName(const std::string& path)
+    {
+        size_t slash = path.find_last_of('/');
+        return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+
+    bool listWavFiles(const std::string& directory, std::vector<std::string>& paths)
+    {
+        DIR* dir = opendir(directory.c_str());
+        if (dir == nullptr) {
+            return false;
+        }
+        std::vector<std::string> found;
+        while (struct dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name[0] != '.' && hasWavExtension(name)) {
+                found.push_back(directory + "/" + name);
+            }
+        }
+        closedir(dir);
+        std::sort(found.begin(), found.end());
+        paths.insert(paths.end(), found.begin(), found.end());
+        return true;
+    }
+
+    bool readManifest(const std::string& manifest, std::vector<std::string>& paths)
+    {
+        std::ifstream stream(manifest);
+        if (!stream) {
+            return false;
+        }
+        std::string line;
+        while (std::getline(stream, line)) {
+            size_t begin = line.find_first_not_of(" \t\r");
+            if (begin == std::string::npos || line[begin] == '#') {
+                continue;
+            }
+            size_t end = line.find_last_not_of(" \t\r");
+            paths.push_back(line.substr(begin, end - begin + 1));
+        }
+        return true;
+    }
+
+    bool parseNumber(const char* text, double& value)
+    {
+        char* end = nullptr;
+        value = strtod(text, &end);
+        return end != text && *end == '\0';
+    }
+
+    bool parseDetectorLink(const std::string& name, IntensifierDSPKernel::DetectorLink& link)
+    {
+        const char* const names[] = { "off", "max", "average", "mid" };
+        for (int mode = 0; mode < 4; ++mode) {
+            if (name == names[mode]) {
+                link = IntensifierDSPKernel::DetectorLink(mode);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool findPreset(const char* name, const IntensifierPreset*& preset)
+    {
+        double index;
+        if (parseNumber(name, index)) {
+            if (index < 0 || index >= IntensifierFactoryPresetCount || index != int(index)) {
+                return false;
+            }
+            preset = &IntensifierFactoryPresets[int(index)];
+            return true;
+        }
+        for (int i = 0; i < IntensifierFactoryPresetCount; ++i) {
+            if (strcmp(name, IntensifierFactoryPresets[i].name) == 0) {
+                preset = &IntensifierFactoryPresets[i];
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool parseOptions(int argc, char* argv[], RenderOptions& options)
+    {
+        const IntensifierPreset* preset = &IntensifierFactoryPresets[0];
+        bool overridden[6] = {};
+        double overrides[6] = {};
+
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg.size() < 2 || arg[0] != '-') {
+                options.inputs.push_back(arg);
+                continue;
+            }
+            if (arg == "-q" || arg == "--quiet") {
+                options.quiet = true;
+                continue;
+            }
+            if (arg == "--stream") {
+                options.stream = true;
+                continue;
+            }
+            if (arg == "--recursive-detectors") {
+                options.recursiveDetectors = true;
+                continue;
+            }
+            if (arg == "-h" || arg == "--help" || !hasValue) {
+                return false;
+            }
+            const char* value = argv[++i];
+            double number = 0.0;
+            if (arg == "-o" || arg == "--output") {
+                options.outputDirectory = value;
+            } else if (arg == "-m" || arg == "--manifest") {
+                options.manifest = value;
+            } else if (arg == "-p" || arg == "--preset") {
+                if (!findPreset(value, preset)) {
+                    fprintf(stderr, "unknown preset %s\n", value);
+                    return false;
+                }
+            } else if (arg == "-j" || arg == "--threads") {
+                if (!parseNumber(value, number) || number < 1) {
+                    return false;
+                }
+                options.threadCount = int(number);
+            } else if (arg == "-b" || arg == "--block-size") {
+                if (!parseNumber(value, number) || number < 1) {
+                    return false;
+                }
+                options.blockSize = int(number);
+            } else if (arg == "--channels-per-task") {
+                if (!parseNumber(value, number) || number < 1) {
+                    return false;
+                }
+                options.channelsPerTask = int(number);
+            } else if (arg == "--task-frames") {
+                if (!parseNumber(value, number) || number < 1) {
+                    return false;
+                }
+                options.taskFrames = int(number);
+            } else if (arg == "--chunk-frames") {
+                if (!parseNumber(value, number) || number < 1) {
+                    return false;
+                }
+                options.chunkFrames = int(number);
+            } else if (arg == "--stats") {
+#if INTENSIFIER_RENDER_STATS
+                options.statsPath = value;
+#else
+                fprintf(stderr, "--stats needs a build with INTENSIFIER_RENDER_STATS=ON\n");
+                return false;
+#endif
+            } else if (arg == "--detector-decimation") {
+                if (!parseNumber(value, number) || number < 1) {
+                    return false;
+                }
+                options.detectorDecimation = int(number);
+            } else if (arg == "--detector-link") {
+                if (!parseDetectorLink(value, options.detectorLink)) {
+                    return false;
+                }
+            } else {
+                bool matched = false;
+                for (int address = 0; address < 6; ++address) {
+                    if (arg.compare(0, 2, "--") == 0 && arg.compare(2, std::string::npos, IntensifierParameterIdentifiers[address]) == 0) {
+                        if (!parseNumber(value, overrides[address])) {
+                            return false;
+                        }
+                        overridden[address] = true;
+                        matched = true;
+                    }
+                }
+                if (!matched) {
+                    fprintf(stderr, "unknown option %s\n", arg.c_str());
+                    return false;
+                }
+            }
+        }
+
+        for (int address = 0; address < 6; ++address) {
+            options.parameters[address] = overridden[address] ? AUValue(overrides[address]) : preset->values[address];
+        }
+        if (options.channelsPerTask > 0 && options.detectorLink != IntensifierDSPKernel::kDetectorLinkOff) {
+            fprintf(stderr, "note: --channels-per-task is ignored with --detector-link; each file renders with one kernel\n");
+        }
+        return !options.outputDirectory.empty() && (!options.inputs.empty() || !options.manifest.empty());
+    }
+
+#if INTENSIFIER_RENDER_STATS
+    /*
+     Writes the counters as metric,value rows. Times are in nanoseconds;
+     load_bucket_N counts the callbacks that took N to N+1 tenths of their
+     deadline, and the last bucket the missed deadlines.
+     */
+    bool writeRenderStats(const std::string& path, const RenderStats::Snapshot& stats)
+    {
+        FILE* file = fopen(path.c_str(), "w");
+        if (file == nullptr) {
+            return false;
+        }
+        fprintf(file, "metric,value\n");
+        fprintf(file, "callbacks,%llu\n", (unsigned long long)stats.callbacks);
+        fprintf(file, "frames,%llu\n", (unsigned long long)stats.frames);
+        fprintf(file, "deadline_misses,%llu\n", (unsigned long long)stats.deadlineMisses);
+        fprintf(file, "callback_ns,%llu\n", (unsigned long long)stats.callbackNanos);
+        fprintf(file, "deadline_ns,%llu\n", (unsigned long long)stats.deadlineNanos);
+        fprintf(file, "max_callback_ns,%llu\n", (unsigned long long)stats.maxCallbackNanos);
+        for (int stage = 0; stage < RenderStats::kStageCount; ++stage) {
+            fprintf(file, "%s_ns,%llu\n", RenderStats::stageName(stage), (unsigned long long)stats.stageNanos[stage]);
+        }
+        for (int bucket = 0; bucket < RenderStats::kHistogramBuckets; ++bucket) {
+            fprintf(file, "load_bucket_%d,%llu\n", bucket, (unsigned long long)stats.histogram[bucket]);
+        }
+        return fclose(file) == 0;
+    }
+#endif
+
+    // Reads a file's header, so its tasks can be laid out before any audio is read.
+    bool probeFile(RenderJob& job)
+    {
+        WavReader reader;
+        if (!reader.open(job.inputPath, job.error)) {
+            return false;
+        }
+        job.channelCount = reader.getChannelCount();
+        job.sampleRate = reader.getSampleRate();
+        job.frameCount = reader.getFrameCount();
+        if (job.channelCount > IntensifierDSPKernel::kMaxChannels) {
+            job.error = job.inputPath + " has more than " + std::to_string(IntensifierDSPKernel::kMaxChannels) + " channels";
+            return false;
+        }
+        return true;
+    }
+
+    void loadFile(RenderJob& job)
+    {
+        WavReader reader;
+        if (!reader.open(job.inputPath, job.error)) {
+            return;
+        }
+        job.audio.assign(job.channelCount, std::vector<float>(size_t(job.frameCount)));
+        float* channels[IntensifierDSPKernel::kMaxChannels];
+        for (int channel = 0; channel < job.channelCount; ++channel) {
+            channels[channel] = job.audio[channel].data();
+        }
+        if (reader.read(channels, size_t(job.frameCount)) != job.frameCount) {
+            job.error = job.inputPath + " is truncated";
+        }
+    }
+
+    IntensifierDSPKernel* createKernel(const RenderOptions& options, int channelCount, double sampleRate)
+    {
+        IntensifierDSPKernel* kernel = new IntensifierDSPKernel();
+        // Parameters go in before init(), which applies them without a ramp.
+        for (int address = 0; address < 6; ++address) {
+            kernel->setParameter(address, options.parameters[address]);
+        }
+        kernel->setDetectorDecimation(options.detectorDecimation);
+        kernel->setRecursiveDetectors(options.recursiveDetectors);
+        kernel->setDetectorLink(options.detectorLink);
+        kernel->init(channelCount, sampleRate);
+        kernel->reset();
+        return kernel;
+    }
+
+    /*
+     Renders frameCount frames of channels, which start at frame position of
+     the file, a block at a time, in place. The kernel reads each frame
+     before writing it, so it can.
+     */
+    void renderBlocks(const RenderOptions& options, IntensifierDSPKernel& kernel, float* const* channels, int channelCount, uint64_t position, uint64_t frameCount)
+    {
+        float* blockChannels[IntensifierDSPKernel::kMaxChannels];
+        for (uint64_t offset = 0; offset < frameCount; offset += uint64_t(options.blockSize)) {
+            AUAudioFrameCount blockFrames = AUAudioFrameCount(std::min(uint64_t(options.blockSize), frameCount - offset));
+            for (int channel = 0; channel < channelCount; ++channel) {
+                blockChannels[channel] = channels[channel] + offset;
+            }
+            kernel.setBuffers(blockChannels, blockChannels);
+            AudioTimeStamp timestamp = {};
+            timestamp.mSampleTime = double(position + offset);
+            kernel.processWithEvents(&timestamp, blockFrames, nullptr, nullptr);
+        }
+    }
+
+    /*
+     Renders frames [start, end) of channels [firstChannel, firstChannel +
+     channelCount) with the group's kernel, in place. The first range
+     creates the kernel.
+     */
+    void renderRange(const RenderOptions& options, RenderJob& job, int group, int firstChannel, int channelCount, uint64_t start, uint64_t end)
+    {
+        if (!job.error.empty()) {
+            return;
+        }
+        std::unique_ptr<IntensifierDSPKernel>& kernel = job.kernels[group];
+        if (start == 0) {
+            kernel.reset(createKernel(options, channelCount, job.sampleRate));
+        }
+        float* channels[IntensifierDSPKernel::kMaxChannels];
+        for (int channel = 0; channel < channelCount; ++channel) {
+            channels[channel] = job.audio[firstChannel + channel].data() + start;
+        }
+        renderBlocks(options, *kernel, channels, channelCount, start, end - start);
+    }
+
+    void writeFile(RenderJob& job)
+    {
+        if (!job.error.empty()) {
+            return;
+        }
+        float* channels[IntensifierDSPKernel::kMaxChannels];
+        for (int channel = 0; channel < job.channelCount; ++channel) {
+            channels[channel] = job.audio[channel].data();
+        }
+        WavWriter writer;
+        if (!writer.open(job.outputPath, job.channelCount, job.sampleRate, job.error)) {
+            return;
+        }
+        if (!writer.write(channels, size_t(job.frameCount)) || !writer.close()) {
+            job.error = "cannot write " + job.outputPath;
+            return;
+        }
+        job.succeeded = true;
+    }
+
+    // Planar audio of one streamed chunk, chunkFrames per channel.
+    struct StreamChunk {
+        std::vector<float> samples;
+        uint64_t position = 0;
+        size_t frameCount = 0;
+    };
+
+    /*
+     Hands chunks from one streaming stage to the next. The chunks come from
+     a fixed pool, so a queue never holds more than the pool and push()
+     never waits; pop() waits for a chunk, and fails once the queue has
+     been closed and drained.
+     */
+    class ChunkQueue {
+    public:
+        void push(StreamChunk* chunk) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                chunks.push_back(chunk);
+            }
+            ready.notify_one();
+        }
+        bool pop(StreamChunk*& chunk) {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this]() { return !chunks.empty() || closed; });
+            if (chunks.empty()) {
+                return false;
+            }
+            chunk = chunks.front();
+            chunks.pop_front();
+            return true;
+        }
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closed = true;
+            }
+            ready.notify_all();
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<StreamChunk*> chunks;
+        bool closed = false;
+    };
+
+    // Chunks in flight per streamed file: one each being read, rendered and written, and a spare.
+    const int kStreamChunks = 4;
+
+    /*
+     Renders a file without holding it in memory. A reader thread decodes
+     chunks into a fixed pool of buffers, this thread renders them with the
+     channel groups' kernels, and a writer thread writes them out, each
+     stage passing chunks on to the next through a ChunkQueue and the
+     writer returning them to the reader. Disk I/O overlaps the DSP, and
+     memory use depends on the chunk size, never on the length of the file.
+     Chunks are whole blocks, so the kernels make the same process calls
+     as when the file is rendered in memory.
+     */
+    void streamFile(const RenderOptions& options, RenderJob& job, int groupChannels)
+    {
+        WavReader reader;
+        WavWriter writer;
+        if (!reader.open(job.inputPath, job.error) || !writer.open(job.outputPath, job.channelCount, job.sampleRate, job.error)) {
+            return;
+        }
+        for (size_t group = 0; group < job.kernels.size(); ++group) {
+            int channelCount = std::min(groupChannels, job.channelCount - int(group) * groupChannels);
+            job.kernels[group].reset(createKernel(options, channelCount, job.sampleRate));
+        }
+
+        size_t chunkFrames = (size_t(options.chunkFrames) + options.blockSize - 1) / options.blockSize * options.blockSize;
+        std::vector<StreamChunk> pool(kStreamChunks);
+        ChunkQueue emptyChunks, readChunks, renderedChunks;
+        for (StreamChunk& chunk : pool) {
+            chunk.samples.resize(chunkFrames * job.channelCount);
+            emptyChunks.push(&chunk);
+        }
+        auto channelsOf = [&](StreamChunk& chunk, float** channels) {
+            for (int channel = 0; channel < job.channelCount; ++channel) {
+                channels[channel] = chunk.samples.data() + channel * chunkFrames;
+            }
+        };
+        // Each error is set by its own stage only; writeFailed stops the reader early.
+        std::string readError, writeError;
+        std::atomic<bool> writeFailed(false);
+
+        std::thread readThread([&]() {
+            uint64_t position = 0;
+            StreamChunk* chunk;
+            while (position < job.frameCount && !writeFailed.load() && emptyChunks.pop(chunk)) {
+                float* channels[IntensifierDSPKernel::kMaxChannels];
+                channelsOf(*chunk, channels);
+                size_t frameCount = size_t(std::min(uint64_t(chunkFrames), job.frameCount - position));
+                chunk->position = position;
+                chunk->frameCount = reader.read(channels, frameCount);
+                position += chunk->frameCount;
+                readChunks.push(chunk);
+                if (chunk->frameCount < frameCount) {
+                    readError = job.inputPath + " is truncated";
+                    break;
+                }
+            }
+            readChunks.close();
+        });
+        std::thread writeThread([&]() {
+            StreamChunk* chunk;
+            while (renderedChunks.pop(chunk)) {
+                float* channels[IntensifierDSPKernel::kMaxChannels];
+                channelsOf(*chunk, channels);
+                if (!writeFailed.load() && !writer.write(channels, chunk->frameCount)) {
+                    writeError = "cannot write " + job.outputPath;
+                    writeFailed.store(true);
+                }
+                emptyChunks.push(chunk);
+            }
+        });
+
+        StreamChunk* chunk;
+        while (readChunks.pop(chunk)) {
+            float* channels[IntensifierDSPKernel::kMaxChannels];
+            channelsOf(*chunk, channels);
+            for (size_t group = 0; group < job.kernels.size() && !writeFailed.load(); ++group) {
+                int firstChannel = int(group) * groupChannels;
+                int channelCount = std::min(groupChannels, job.channelCount - firstChannel);
+                renderBlocks(options, *job.kernels[group], channels + firstChannel, channelCount, chunk->position, chunk->frameCount);
+            }
+            renderedChunks.push(chunk);
+        }
+        renderedChunks.close();
+        readThread.join();
+        writeThread.join();
+
+        if (!readError.empty() || !writeError.empty()) {
+            job.error = readError.empty() ? writeError : readError;
+            return;
+        }
+        if (!writer.close()) {
+            job.error = "cannot write " + job.outputPath;
+            return;
+        }
+        job.succeeded = true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    RenderOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+
+    std::vector<std::string> inputPaths;
+    if (!options.manifest.empty() && !readManifest(options.manifest, inputPaths)) {
+        fprintf(stderr, "cannot read manifest %s\n", options.manifest.c_str());
+        return 1;
+    }
+    for (const std::string& input : options.inputs) {
+        if (isDirectory(input)) {
+            if (!listWavFiles(input, inputPaths)) {
+                fprintf(stderr, "cannot read directory %s\n", input.c_str());
+                return 1;
+            }
+        } else {
+            inputPaths.push_back(input);
+        }
+    }
+    if (inputPaths.empty()) {
+        fprintf(stderr, "no input files\n");
+        return 1;
+    }
+
+    if (!isDirectory(options.outputDirectory) && mkdir(options.outputDirectory.c_str(), 0777) != 0) {
+        fprintf(stderr, "cannot create output directory %s\n", options.outputDirectory.c_str());
+        return 1;
+    }
+
+    std::vector<RenderJob> jobs(inputPaths.size());
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        jobs[i].inputPath = inputPaths[i];
+        jobs[i].outputPath = options.outputDirectory + "/" + fileName(inputPaths[i]);
+    }
+    // Never let one job overwrite another job's input.
+    for (const RenderJob& job : jobs) {
+        for (const std::string& input : inputPaths) {
+            struct stat outputInfo, inputInfo;
+            if (stat(job.outputPath.c_str(), &outputInfo) == 0 && stat(input.c_str(), &inputInfo) == 0
+                && outputInfo.st_dev == inputInfo.st_dev && outputInfo.st_ino == inputInfo.st_ino) {
+                fprintf(stderr, "refusing to overwrite input %s\n", input.c_str());
+                return 1;
+            }
+        }
+    }
+
+    /*
+     One chain per file: load, then each channel group's ranges in order,
+     then write. The groups' ranges depend only on the load and their own
+     previous range, so groups and files render side by side. Task sizes
+     are whole blocks, so splitting a group into ranges makes the same
+     process calls as rendering it in one go.
+     */
+    std::mutex printMutex;
+#if INTENSIFIER_RENDER_STATS
+    RenderStats::Snapshot renderStats;
+#endif
+    auto reportJob = [&](const RenderJob& job) {
+        if (!job.succeeded || !options.quiet) {
+            std::lock_guard<std::mutex> lock(printMutex);
+            if (job.succeeded) {
+                printf("%s -> %s\n", job.inputPath.c_str(), job.outputPath.c_str());
+            } else {
+                fprintf(stderr, "error: %s\n", job.error.c_str());
+            }
+        }
+    };
+    // Called once a group's kernel is done.
+    auto releaseKernel = [&](RenderJob& job, int group) {
+#if INTENSIFIER_RENDER_STATS
+        if (job.kernels[group]) {
+            std::lock_guard<std::mutex> lock(printMutex);
+            renderStats.merge(job.kernels[group]->getRenderStats().snapshot());
+        }
+#endif
+        job.kernels[group].reset();
+    };
+    uint64_t taskFrames = (uint64_t(options.taskFrames) + options.blockSize - 1) / options.blockSize * options.blockSize;
+    TaskGraph graph;
+    int chainCount = 0;
+    for (RenderJob& job : jobs) {
+        if (!probeFile(job)) {
+            fprintf(stderr, "error: %s\n", job.error.c_str());
+            continue;
+        }
+        RenderJob* renderJob = &job;
+        // Linked detectors need all of a file's channels in one kernel.
+        bool wholeFile = options.channelsPerTask == 0 || options.detectorLink != IntensifierDSPKernel::kDetectorLinkOff;
+        int groupChannels = wholeFile ? job.channelCount : std::min(options.channelsPerTask, job.channelCount);
+        int groupCount = std::max(1, (job.channelCount + groupChannels - 1) / groupChannels);
+        job.kernels.resize(groupCount);
+
+        if (options.stream) {
+            graph.addTask([&, renderJob, groupChannels, groupCount]() {
+                streamFile(options, *renderJob, groupChannels);
+                for (int group = 0; group < groupCount; ++group) {
+                    releaseKernel(*renderJob, group);
+                }
+                reportJob(*renderJob);
+            });
+            ++chainCount;
+            continue;
+        }
+        chainCount += groupCount;
+
+        TaskGraph::TaskId load = graph.addTask([renderJob]() { loadFile(*renderJob); });
+        TaskGraph::TaskId write = graph.addTask([&, renderJob]() {
+            writeFile(*renderJob);
+            renderJob->audio.clear();
+            renderJob->audio.shrink_to_fit();
+            reportJob(*renderJob);
+        });
+        for (int group = 0; group < groupCount; ++group) {
+            int firstChannel = group * groupChannels;
+            int channelCount = std::min(groupChannels, job.channelCount - firstChannel);
+            TaskGraph::TaskId previous = load;
+            for (uint64_t start = 0; start < job.frameCount; start += taskFrames) {
+                uint64_t end = std::min(start + taskFrames, job.frameCount);
+                bool last = end == job.frameCount;
+                TaskGraph::TaskId range = graph.addTask([&, renderJob, group, firstChannel, channelCount, start, end, last]() {
+                    renderRange(options, *renderJob, group, firstChannel, channelCount, start, end);
+                    if (last) {
+                        releaseKernel(*renderJob, group);
+                    }
+                });
+                graph.addDependency(previous, range);
+                previous = range;
+            }
+            graph.addDependency(previous, write);
+        }
+    }
+
+    int threadCount = options.threadCount;
+    if (threadCount == 0) {
+        threadCount = std::max(1, int(std::thread::hardware_concurrency()));
+    }
+    threadCount = std::max(1, std::min(threadCount, chainCount));
+    WorkStealingExecutor executor(threadCount);
+
+    auto start = std::chrono::steady_clock::now();
+    executor.run(graph);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t rendered = 0;
+    double audioSeconds = 0.0;
+    for (const RenderJob& job : jobs) {
+        if (job.succeeded) {
+            ++rendered;
+            audioSeconds += double(job.frameCount) / job.sampleRate;
+        }
+    }
+    seconds = std::max(seconds, 1e-9);
+    printf("rendered %zu of %zu files (%.1f s of audio) in %.3f s on %d threads: %.2f files/s, %.1fx realtime\n",
+           rendered, jobs.size(), audioSeconds, seconds, threadCount, rendered / seconds, audioSeconds / seconds);
+#if INTENSIFIER_RENDER_STATS
+    if (!options.statsPath.empty() && !writeRenderStats(options.statsPath, renderStats)) {
+        fprintf(stderr, "cannot write %s\n", options.statsPath.c_str());
+        return 1;
+    }
+#endif
+    return rendered == jobs.size() ? 0 : 1;
+}
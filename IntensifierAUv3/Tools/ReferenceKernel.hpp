@@ -0,0 +1,232 @@
+#ifndef ReferenceKernel_h
+#define ReferenceKernel_h
+#include "DSPTypes.hpp"
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+
+/*
+ IntensifierReferenceKernel
+ The Intensifier algorithm as the original kernel computed it: one frame at
+ a time, one channel at a time, with the original rmsaverage, slide and
+ AdjustableDelayLine arithmetic and decibels converted with pow() in
+ double. It depends on nothing in the DSP core but its types: the
+ constants, parameter ranges and helpers are copied here, so changes to
+ the core cannot move the reference with them. intensifier-bench --check
+ renders it next to the optimized kernels to catch optimizations that
+ change the sound.
+
+ It is frozen: do not optimize it, and only change it together with a
+ deliberate change to the sound. Each channel has its own detectors and
+ delay, the one such change so far. The RMS windows keep the original
+ float running sums, which the optimized kernels replaced with exact
+ ones, so the two differ by the sums' rounding; --check's tolerances
+ allow for it.
+
+ It covers full-rate, unlinked detection. Parameters set at init() apply
+ from the first frame; the rendered sound is the kernel's after its
+ parameters have settled, so they are set before init() on both sides.
+ startRamp() ramps them as the original ParameterRamper did: a line
+ evaluated once per frame, for automation at a frame the caller splits
+ process() at.
+ */
+class IntensifierReferenceKernel {
+public:
+    // Parameters, in IntensifierParam address order.
+    static constexpr int kParameterCount = 6;
+
+    void init(int channelCount, double inSampleRate, const AUValue* parameters)
+    {
+        channels = channelCount;
+        sampleRate = float(inSampleRate);
+        for (int address = 0; address < kParameterCount; ++address) {
+            ramps[address] = Ramp();
+            ramps[address].goal = clampParameter(address, parameters[address]);
+        }
+        // The delay line holds 10 ms, truncated to whole samples, and is read a full buffer behind.
+        delayFrames = size_t(int(kLookaheadMs * sampleRate / 1000.0));
+        states.assign(channels, ChannelState());
+        for (ChannelState& state : states) {
+            state.attackWindow.init(kAttackRMSPoints);
+            state.releaseWindow.init(kReleaseRMSPoints);
+            state.delay.assign(delayFrames, 0.0f);
+        }
+    }
+
+    // Ramps parameter address from its current value to value over duration frames, or sets it for 0.
+    void startRamp(int address, AUValue value, uint32_t duration)
+    {
+        Ramp& ramp = ramps[address];
+        value = clampParameter(address, value);
+        ramp.inverseSlope = duration > 0 ? (ramp.get() - value) / float(duration) : 0.0f;
+        ramp.samplesRemaining = duration;
+        ramp.goal = value;
+    }
+
+    void process(const float* const* in, float* const* out, int frameCount)
+    {
+        for (int frame = 0; frame < frameCount; ++frame) {
+            AUValue values[kParameterCount];
+            for (int address = 0; address < kParameterCount; ++address) {
+                values[address] = ramps[address].get();
+                ramps[address].step();
+            }
+            float attackAmount = values[kAttackAmount] * 2.5;
+            float releaseAmount = values[kReleaseAmount] * 2.5;
+            // Milliseconds to samples in double, rounded to float, then truncated to whole samples.
+            float attackSlide = slideSamples(float(values[kAttackTime] * (sampleRate / 1000.0)));
+            float releaseSlide = slideSamples(float((values[kReleaseTime] * 1000) * (sampleRate / 1000.0)));
+
+            for (int channel = 0; channel < channels; ++channel) {
+                ChannelState& state = states[channel];
+                float gained = float(in[channel][frame] * pow(10., values[kInputAmount] / 20.0));
+
+                // Attack: slide up, keep only the part of the RMS above it, then slide down.
+                float rms = state.attackWindow.push(gained);
+                state.attackSlideUp = slide(rms, state.attackSlideUp, attackSlide, 0.0f);
+                float attack = rms >= state.attackSlideUp ? rms - state.attackSlideUp : 0.0f;
+                state.attackSlideDown = slide(attack, state.attackSlideDown, 0.0f, attackSlide);
+
+                // Release: slide down, then keep only the part of the RMS below it.
+                rms = state.releaseWindow.push(gained);
+                state.releaseSlideDown = slide(rms, state.releaseSlideDown, 0.0f, releaseSlide);
+                float release = rms <= state.releaseSlideDown ? state.releaseSlideDown - rms : 0.0f;
+
+                // Envelopes to decibels, then amplitude, then the output gain, each rounded to float.
+                float gain = state.attackSlideDown * attackAmount + release * releaseAmount;
+                gain = float(pow(10., gain / 20.0));
+                gain = float(gain * pow(10., values[kOutputAmount] / 20.0));
+
+                float delayed = state.delay[state.delayIndex];
+                state.delay[state.delayIndex] = gained;
+                state.delayIndex = state.delayIndex + 1 == delayFrames ? 0 : state.delayIndex + 1;
+                out[channel][frame] = delayed * gain;
+            }
+        }
+        for (ChannelState& state : states) {
+            state.attackSlideUp = convertBadValuesToZero(state.attackSlideUp);
+            state.attackSlideDown = convertBadValuesToZero(state.attackSlideDown);
+            state.releaseSlideDown = convertBadValuesToZero(state.releaseSlideDown);
+        }
+    }
+
+private:
+    enum {
+        kInputAmount = 0,
+        kAttackAmount = 1,
+        kReleaseAmount = 2,
+        kAttackTime = 3,
+        kReleaseTime = 4,
+        kOutputAmount = 5
+    };
+    // Detector windows, in samples, and the lookahead.
+    static constexpr unsigned int kAttackRMSPoints = 441;
+    static constexpr unsigned int kReleaseRMSPoints = 882;
+    static constexpr double kLookaheadMs = 10.0;
+
+    static AUValue clampParameter(int address, AUValue value)
+    {
+        static const AUValue ranges[kParameterCount][2] = {
+            {-40.0f, 15.0f}, {-40.0f, 30.0f}, {-40.0f, 30.0f}, {0.0f, 500.0f}, {0.0f, 5.0f}, {-40.0f, 15.0f}
+        };
+        return value < ranges[address][0] ? ranges[address][0] : (value > ranges[address][1] ? ranges[address][1] : value);
+    }
+    // Denormals, NaNs and infinities to zero.
+    static float convertBadValuesToZero(float x)
+    {
+        float absx = fabs(x);
+        return absx > 1e-15 && absx < 1e15 ? x : 0.0f;
+    }
+
+    // A parameter's value, as a line through the goal: inverseSlope * samplesRemaining + goal.
+    struct Ramp {
+        float goal = 0.0f;
+        float inverseSlope = 0.0f;
+        uint32_t samplesRemaining = 0;
+
+        float get() const {
+            return inverseSlope * float(samplesRemaining) + goal;
+        }
+        void step() {
+            if (samplesRemaining != 0) {
+                --samplesRemaining;
+            }
+        }
+    };
+
+    /*
+     Moving RMS over the last pointCount samples, as rmsaverage computed it:
+     a float running sum of squares, replaced once per window by a second
+     sum started at the previous replacement. A NaN result (from a NaN input
+     or a sum rounded below zero) gives the input instead.
+     */
+    struct RMSWindow {
+        std::vector<float> inputs;
+        size_t next = 0;
+        size_t count = 0;
+        float sum = 0.0f;
+        float calibration = 0.0f;
+
+        void init(unsigned int pointCount) {
+            inputs.assign(pointCount, 0.0f);
+            next = 0;
+            count = 0;
+            sum = 0.0f;
+            calibration = 0.0f;
+        }
+        float push(float input) {
+            sum += input * input;
+            calibration += input * input;
+            if (count < inputs.size()) {
+                ++count;
+            } else {
+                sum -= inputs[next] * inputs[next];
+            }
+            inputs[next] = input;
+            float result = sqrtf(sum / float(inputs.size()));
+            if (++next == inputs.size()) {
+                next = 0;
+                sum = calibration;
+                calibration = 0.0f;
+            }
+            return result != result ? input : result;
+        }
+    };
+
+    struct ChannelState {
+        RMSWindow attackWindow;
+        RMSWindow releaseWindow;
+        float attackSlideUp = 0.0f;
+        float attackSlideDown = 0.0f;
+        float releaseSlideDown = 0.0f;
+        std::vector<float> delay;
+        size_t delayIndex = 0;
+    };
+
+    // Slide length in whole samples, or 0 for none.
+    static float slideSamples(float samples)
+    {
+        int whole = int(samples);
+        return whole > 1 ? float(whole) : 0.0f;
+    }
+    // Moves last 1/length of the way to input, up or down; snaps to input once the step is lost in rounding.
+    static float slide(float input, float last, float upSamples, float downSamples)
+    {
+        float length = input >= last ? upSamples : downSamples;
+        if (length <= 1.0f) {
+            return input;
+        }
+        float stepped = last + (input - last) / length;
+        if (stepped == last || stepped != stepped) {
+            return input;
+        }
+        return stepped;
+    }
+
+    int channels = 0;
+    float sampleRate = 44100.0f;
+    Ramp ramps[kParameterCount];
+    size_t delayFrames = 0;
+    std::vector<ChannelState> states;
+};
+#endif /* ReferenceKernel_h */
@@ -0,0 +1,280 @@
+#include "WavFile.hpp"
+#include <string.h>
+#include <sys/types.h>
+
+namespace {
+    const uint16_t kFormatPCM = 1;
+    const uint16_t kFormatFloat = 3;
+    const uint16_t kFormatExtensible = 0xFFFE;
+    const size_t kMaxChunkFrames = 4096;
+    // Header of the files WavWriter writes: RIFF, a 28 byte JUNK chunk that close() may turn into ds64, fmt and data.
+    const size_t kHeaderSize = 80;
+    const uint32_t kRF64Size = 0xFFFFFFFF;
+
+    uint16_t readUInt16(const uint8_t* bytes)
+    {
+        return uint16_t(bytes[0] | (bytes[1] << 8));
+    }
+
+    uint32_t readUInt32(const uint8_t* bytes)
+    {
+        return uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
+    }
+
+    void writeUInt16(uint8_t* bytes, uint16_t value)
+    {
+        bytes[0] = uint8_t(value);
+        bytes[1] = uint8_t(value >> 8);
+    }
+
+    uint64_t readUInt64(const uint8_t* bytes)
+    {
+        return uint64_t(readUInt32(bytes)) | (uint64_t(readUInt32(bytes + 4)) << 32);
+    }
+
+    void writeUInt32(uint8_t* bytes, uint32_t value)
+    {
+        writeUInt16(bytes, uint16_t(value));
+        writeUInt16(bytes + 2, uint16_t(value >> 16));
+    }
+
+    void writeUInt64(uint8_t* bytes, uint64_t value)
+    {
+        writeUInt32(bytes, uint32_t(value));
+        writeUInt32(bytes + 4, uint32_t(value >> 32));
+    }
+}
+
+bool WavReader::open(const std::string& path, std::string& error)
+{
+    close();
+    file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    uint8_t header[12];
+    bool readHeader = fread(header, 1, sizeof(header), file) == sizeof(header);
+    bool isRF64 = readHeader && memcmp(header, "RF64", 4) == 0;
+    if (!readHeader || (memcmp(header, "RIFF", 4) != 0 && !isRF64) || memcmp(header + 8, "WAVE", 4) != 0) {
+        error = path + " is not a RIFF WAVE file";
+        close();
+        return false;
+    }
+
+    bool foundFormat = false;
+    bool foundData = false;
+    uint16_t formatTag = 0;
+    off_t dataOffset = 0;
+    uint64_t dataSize = 0;
+    uint64_t rf64DataSize = 0;
+    uint8_t chunkHeader[8];
+    while (fread(chunkHeader, 1, sizeof(chunkHeader), file) == sizeof(chunkHeader)) {
+        uint64_t chunkSize = readUInt32(chunkHeader + 4);
+        // In RF64 the data chunk's size is in the ds64 chunk that comes first.
+        if (isRF64 && chunkSize == kRF64Size && memcmp(chunkHeader, "data", 4) == 0) {
+            chunkSize = rf64DataSize;
+        }
+        off_t chunkEnd = ftello(file) + off_t(chunkSize) + off_t(chunkSize & 1);
+        if (isRF64 && memcmp(chunkHeader, "ds64", 4) == 0) {
+            uint8_t sizes[16];
+            if (chunkSize < sizeof(sizes) || fread(sizes, 1, sizeof(sizes), file) != sizeof(sizes)) {
+                break;
+            }
+            rf64DataSize = readUInt64(sizes + 8);
+        } else if (memcmp(chunkHeader, "fmt ", 4) == 0) {
+            uint8_t format[40] = {};
+            size_t formatSize = chunkSize < sizeof(format) ? chunkSize : sizeof(format);
+            if (formatSize < 16 || fread(format, 1, formatSize, file) != formatSize) {
+                break;
+            }
+            formatTag = readUInt16(format);
+            channelCount = readUInt16(format + 2);
+            sampleRate = readUInt32(format + 4);
+            bytesPerFrame = readUInt16(format + 12);
+            bitsPerSample = readUInt16(format + 14);
+            if (formatTag == kFormatExtensible && formatSize >= 26) {
+                // The first two bytes of the sub-format GUID are the format tag.
+                formatTag = readUInt16(format + 24);
+            }
+            foundFormat = true;
+        } else if (memcmp(chunkHeader, "data", 4) == 0) {
+            dataOffset = ftello(file);
+            dataSize = chunkSize;
+            foundData = true;
+        }
+        if (foundFormat && foundData) {
+            break;
+        }
+        fseeko(file, chunkEnd, SEEK_SET);
+    }
+
+    if (!foundFormat || !foundData) {
+        error = path + " has no fmt or data chunk";
+        close();
+        return false;
+    }
+    isFloat = formatTag == kFormatFloat;
+    bool supported = (formatTag == kFormatPCM && (bitsPerSample == 8 || bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32))
+        || (isFloat && (bitsPerSample == 32 || bitsPerSample == 64));
+    if (!supported || channelCount == 0 || bytesPerFrame != channelCount * bitsPerSample / 8) {
+        error = path + " has an unsupported sample format";
+        close();
+        return false;
+    }
+
+    frameCount = dataSize / uint64_t(bytesPerFrame);
+    framesRead = 0;
+    fseeko(file, dataOffset, SEEK_SET);
+    return true;
+}
+
+void WavReader::close()
+{
+    if (file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+size_t WavReader::read(float* const* buffers, size_t frames)
+{
+    size_t framesDone = 0;
+    while (framesDone < frames && framesRead < frameCount) {
+        size_t chunkFrames = frames - framesDone;
+        if (chunkFrames > kMaxChunkFrames) {
+            chunkFrames = kMaxChunkFrames;
+        }
+        if (chunkFrames > frameCount - framesRead) {
+            chunkFrames = size_t(frameCount - framesRead);
+        }
+        rawBuffer.resize(chunkFrames * bytesPerFrame);
+        size_t got = fread(rawBuffer.data(), bytesPerFrame, chunkFrames, file);
+        if (got == 0) {
+            break;
+        }
+
+        int bytesPerSample = bitsPerSample / 8;
+        for (int channel = 0; channel < channelCount; ++channel) {
+            const uint8_t* in = rawBuffer.data() + channel * bytesPerSample;
+            float* out = buffers[channel] + framesDone;
+            for (size_t frame = 0; frame < got; ++frame, in += bytesPerFrame) {
+                if (isFloat && bitsPerSample == 32) {
+                    memcpy(&out[frame], in, sizeof(float));
+                } else if (isFloat) {
+                    double value;
+                    memcpy(&value, in, sizeof(double));
+                    out[frame] = float(value);
+                } else if (bitsPerSample == 8) {
+                    out[frame] = (float(in[0]) - 128.0f) / 128.0f;
+                } else if (bitsPerSample == 16) {
+                    out[frame] = float(int16_t(readUInt16(in))) / 32768.0f;
+                } else if (bitsPerSample == 24) {
+                    int32_t value = int32_t(uint32_t(in[0]) << 8 | uint32_t(in[1]) << 16 | uint32_t(in[2]) << 24) >> 8;
+                    out[frame] = float(value) / 8388608.0f;
+                } else {
+                    out[frame] = float(int32_t(readUInt32(in))) / 2147483648.0f;
+                }
+            }
+        }
+        framesDone += got;
+        framesRead += got;
+        if (got < chunkFrames) {
+            break;
+        }
+    }
+    return framesDone;
+}
+
+bool WavWriter::open(const std::string& path, int channels, double sampleRate, std::string& error)
+{
+    close();
+    file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        error = "cannot create " + path;
+        return false;
+    }
+    channelCount = channels;
+    framesWritten = 0;
+    failed = false;
+
+    uint16_t blockAlign = uint16_t(channels * sizeof(float));
+    uint8_t header[kHeaderSize] = {};
+    memcpy(header, "RIFF", 4);
+    memcpy(header + 8, "WAVE", 4);
+    memcpy(header + 12, "JUNK", 4);
+    writeUInt32(header + 16, 28);
+    memcpy(header + 48, "fmt ", 4);
+    writeUInt32(header + 52, 16);
+    writeUInt16(header + 56, kFormatFloat);
+    writeUInt16(header + 58, uint16_t(channels));
+    writeUInt32(header + 60, uint32_t(sampleRate));
+    writeUInt32(header + 64, uint32_t(sampleRate) * blockAlign);
+    writeUInt16(header + 68, blockAlign);
+    writeUInt16(header + 70, 32);
+    memcpy(header + 72, "data", 4);
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header)) {
+        error = "cannot write " + path;
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool WavWriter::write(const float* const* buffers, size_t frames)
+{
+    if (file == nullptr || failed) {
+        return false;
+    }
+    interleaved.resize(frames * channelCount);
+    for (int channel = 0; channel < channelCount; ++channel) {
+        const float* in = buffers[channel];
+        for (size_t frame = 0; frame < frames; ++frame) {
+            interleaved[frame * channelCount + channel] = in[frame];
+        }
+    }
+    if (fwrite(interleaved.data(), sizeof(float) * channelCount, frames, file) != frames) {
+        failed = true;
+        return false;
+    }
+    framesWritten += frames;
+    return true;
+}
+
+bool WavWriter::close()
+{
+    if (file == nullptr) {
+        return !failed;
+    }
+    uint64_t dataSize = framesWritten * channelCount * sizeof(float);
+    uint64_t riffSize = dataSize + kHeaderSize - 8;
+    bool ok = !failed;
+    if (ok && riffSize < kRF64Size) {
+        uint8_t size[4];
+        writeUInt32(size, uint32_t(riffSize));
+        ok = fseeko(file, 4, SEEK_SET) == 0 && fwrite(size, 1, 4, file) == 4;
+        writeUInt32(size, uint32_t(dataSize));
+        ok = ok && fseeko(file, 76, SEEK_SET) == 0 && fwrite(size, 1, 4, file) == 4;
+    } else if (ok) {
+        // RF64: the 32 bit sizes become 0xFFFFFFFF and the real ones go into the ds64 chunk in place of JUNK.
+        uint8_t header[48];
+        memcpy(header, "RF64", 4);
+        writeUInt32(header + 4, kRF64Size);
+        memcpy(header + 8, "WAVE", 4);
+        memcpy(header + 12, "ds64", 4);
+        writeUInt32(header + 16, 28);
+        writeUInt64(header + 20, riffSize);
+        writeUInt64(header + 28, dataSize);
+        writeUInt64(header + 36, framesWritten);
+        writeUInt32(header + 44, 0);
+        uint8_t size[4];
+        writeUInt32(size, kRF64Size);
+        ok = fseeko(file, 0, SEEK_SET) == 0 && fwrite(header, 1, sizeof(header), file) == sizeof(header);
+        ok = ok && fseeko(file, 76, SEEK_SET) == 0 && fwrite(size, 1, 4, file) == 4;
+    }
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    failed = !ok;
+    return ok;
+}
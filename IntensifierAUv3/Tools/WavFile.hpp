@@ -0,0 +1,64 @@
+#ifndef WavFile_h
+#define WavFile_h
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/*
+ WavReader
+ Minimal RIFF WAVE reader for the offline tools. Reads 8, 16, 24 and 32 bit
+ integer PCM and 32 or 64 bit float, plain or WAVE_FORMAT_EXTENSIBLE, from
+ RIFF or, for files over 4 GB, RF64 files into planar float buffers. Reads
+ are chunked, so a file never has to fit in memory. Assumes a little-endian
+ host.
+ */
+class WavReader {
+public:
+    ~WavReader() { close(); }
+
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    int getChannelCount() const { return channelCount; }
+    double getSampleRate() const { return sampleRate; }
+    uint64_t getFrameCount() const { return frameCount; }
+
+    // Reads up to frames frames, one buffer per channel. Returns the number of frames read.
+    size_t read(float* const* buffers, size_t frames);
+
+private:
+    FILE* file = nullptr;
+    int channelCount = 0;
+    int bitsPerSample = 0;
+    int bytesPerFrame = 0;
+    bool isFloat = false;
+    double sampleRate = 0.0;
+    uint64_t frameCount = 0;
+    uint64_t framesRead = 0;
+    std::vector<uint8_t> rawBuffer;
+};
+
+/*
+ WavWriter
+ Writes 32 bit float RIFF WAVE from planar float buffers, in chunks. The
+ header sizes are patched by close(), which turns the file into RF64 if
+ its data outgrew the 4 GB RIFF limit, using the space a JUNK chunk
+ reserved after the RIFF header for the 64 bit sizes.
+ */
+class WavWriter {
+public:
+    ~WavWriter() { close(); }
+
+    bool open(const std::string& path, int channels, double sampleRate, std::string& error);
+    bool write(const float* const* buffers, size_t frames);
+    bool close();
+
+private:
+    FILE* file = nullptr;
+    int channelCount = 0;
+    uint64_t framesWritten = 0;
+    bool failed = false;
+    std::vector<float> interleaved;
+};
+#endif /* WavFile_h */